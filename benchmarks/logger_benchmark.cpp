@@ -0,0 +1,57 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "AsyncLib/logger.hpp"
+
+// Measures how long a call to Info takes on the logging thread, which is all
+// the application pays for as formatting happens on the sink's thread. Build
+// with optimisations enabled (e.g. -DCMAKE_BUILD_TYPE=Release)
+
+constexpr std::uint64_t NUM_LOGS = 1'000'000;
+// Logs are timed in bursts that fit in the backend's queue, which is drained
+// in between, so the numbers are not limited by how fast the backend formats
+constexpr std::uint64_t BURST_SIZE = LOG_QUEUE_SIZE / 2;
+
+typedef std::chrono::steady_clock timer;
+
+int main() {
+  // Release builds only log errors by default
+  async_lib::SetGlobalLogLevel(async_lib::LogLevel::INFO);
+  async_lib::internal::loggerRegistry.CreateSink(
+      "benchmark", std::make_shared<std::ostringstream>());
+  async_lib::internal::loggerRegistry.CreateLogger("Benchmark", "benchmark");
+  auto logger = async_lib::internal::loggerRegistry.GetLogger("Benchmark");
+  std::string const name = "player";
+
+  double nanoseconds = 0;
+  for (std::uint64_t burst = 0; burst < NUM_LOGS; burst += BURST_SIZE) {
+    auto const end = std::min(burst + BURST_SIZE, NUM_LOGS);
+    auto const start = timer::now();
+    for (std::uint64_t i = burst; i < end; ++i) {
+      logger->Info("{} moved to ({}, {}) after {} frames", name, 1.5f * i, 2.5,
+                   i);
+    }
+    nanoseconds +=
+        std::chrono::duration<double, std::nano>(timer::now() - start).count();
+    async_lib::internal::loggerRegistry.FlushAll();
+  }
+
+  std::cout << "Info: " << nanoseconds / NUM_LOGS << " ns/call" << std::endl;
+
+  // What a log below the logger's level costs
+  auto const filteredStart = timer::now();
+  for (std::uint64_t i = 0; i < NUM_LOGS; ++i) {
+    LOG_DEBUG(logger, "{} moved to ({}, {}) after {} frames", name, 1.5f * i,
+              2.5, i);
+  }
+  auto const filteredNanoseconds =
+      std::chrono::duration<double, std::nano>(timer::now() - filteredStart)
+          .count();
+
+  std::cout << "Filtered Debug: " << filteredNanoseconds / NUM_LOGS
+            << " ns/call" << std::endl;
+}
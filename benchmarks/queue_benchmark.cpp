@@ -0,0 +1,75 @@
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+
+#include "AsyncLib/queue.hpp"
+
+// Measures single-producer/single-consumer throughput of each queue policy.
+// Build with optimisations enabled (e.g. -DCMAKE_BUILD_TYPE=Release)
+
+constexpr std::size_t QUEUE_SIZE = 1024;
+constexpr std::uint64_t NUM_ITEMS = 10'000'000;
+
+typedef std::chrono::steady_clock timer;
+
+// The basic queue has no Try functions so we check the size first
+template <class Queue>
+void Produce(Queue& queue, std::uint64_t item) {
+  if constexpr (requires { queue.TryPush(item); }) {
+    while (!queue.TryPush(item)) {
+      std::this_thread::yield();
+    }
+  } else {
+    while (queue.Size() >= queue.Capacity()) {
+      std::this_thread::yield();
+    }
+    queue.Push(item);
+  }
+}
+
+template <class Queue>
+std::uint64_t Consume(Queue& queue) {
+  if constexpr (requires(std::uint64_t& item) { queue.TryPop(item); }) {
+    std::uint64_t item;
+    while (!queue.TryPop(item)) {
+      std::this_thread::yield();
+    }
+    return item;
+  } else {
+    while (queue.Size() == 0) {
+      std::this_thread::yield();
+    }
+    return queue.Pop();
+  }
+}
+
+template <class Policy>
+void RunBenchmark(char const* name) {
+  auto queue = std::make_unique<
+      async_lib::Queue<std::uint64_t, QUEUE_SIZE, Policy>>();
+
+  auto const start = timer::now();
+  std::thread producer([&]() {
+    for (std::uint64_t i = 0; i < NUM_ITEMS; ++i) {
+      Produce(*queue, i);
+    }
+  });
+
+  std::uint64_t sum = 0;
+  for (std::uint64_t i = 0; i < NUM_ITEMS; ++i) {
+    sum += Consume(*queue);
+  }
+  producer.join();
+  auto const seconds =
+      std::chrono::duration<double>(timer::now() - start).count();
+
+  std::cout << name << ": " << static_cast<std::uint64_t>(NUM_ITEMS / seconds)
+            << " ops/sec (checksum " << sum << ")" << std::endl;
+}
+
+int main() {
+  RunBenchmark<async_lib::queue_policy::Basic>("Basic");
+  RunBenchmark<async_lib::queue_policy::SPSC>("SPSC");
+  RunBenchmark<async_lib::queue_policy::MPMC>("MPMC");
+}
@@ -0,0 +1,438 @@
+#ifndef ASYNC_LIB_BINARY_LOG_HPP
+#define ASYNC_LIB_BINARY_LOG_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "AsyncLib/logger.hpp"
+#include "fmt/args.h"
+#include "fmt/format.h"
+
+namespace async_lib {
+
+namespace internal {
+
+// A binary log starts with BINARY_LOG_MAGIC, BINARY_LOG_VERSION and the i64
+// nanoseconds since the Unix epoch that log times are relative to, followed
+// by records that each start with a BinaryRecord tag. Component names, layouts
+// and format strings are written once, the first time a log uses them, and
+// logs then refer to them by id. Everything is in native byte order
+constexpr char BINARY_LOG_MAGIC[8] = {'A', 'S', 'Y', 'N', 'C', 'L', 'O', 'G'};
+constexpr std::uint32_t BINARY_LOG_VERSION = 2;
+
+enum class BinaryRecord : std::uint8_t {
+  COMPONENT,  // u32 id, u32 size, name
+  LAYOUT,     // u32 id, u32 size, pattern
+  FORMAT,     // u32 id, u8 count, count LogArgTypes, u32 size, format string
+  LOG         // u64 nanoseconds, u32 seq, u32 thread, u8 level, u32 component,
+              // u32 layout, u32 format, u32 size, arguments as encoded by
+              // LogArgs
+};
+
+template <class T>
+void AppendBinary(std::string& out, T const value) {
+  static_assert(std::is_trivially_copyable_v<T>);
+  out.append(reinterpret_cast<char const*>(&value), sizeof(value));
+}
+
+inline void AppendBinary(std::string& out, std::string_view const value) {
+  AppendBinary(out, static_cast<std::uint32_t>(value.size()));
+  out.append(value);
+}
+
+// Reads the values written by AppendBinary, failing once it runs out of data
+class BinaryReader {
+ public:
+  explicit BinaryReader(std::istream& in) : in_(in) {}
+
+  template <class T>
+  bool Read(T& value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    return static_cast<bool>(
+        in_.read(reinterpret_cast<char*>(&value), sizeof(value)));
+  }
+
+  bool Read(std::string& value) {
+    std::uint32_t size;
+    if (!Read(size)) {
+      return false;
+    }
+    value.resize(size);
+    return static_cast<bool>(in_.read(value.data(), size));
+  }
+
+ private:
+  std::istream& in_;
+};
+
+struct TransparentStringHash {
+  typedef void is_transparent;
+
+  std::size_t operator()(std::string_view const key) const {
+    return std::hash<std::string_view>{}(key);
+  }
+};
+
+}  // namespace internal
+
+// Writes logs in a compact binary form rather than as text, so the backend
+// skips formatting altogether and much less is written. Turn the file back
+// into text with DecodeBinaryLog (or the log_decoder tool). Buffered and
+// flushed the same way as FileSink
+class BinarySink : public FileSink {
+ public:
+  explicit BinarySink(std::string const& path, FlushPolicy const& policy = {})
+      : FileSink(path, policy) {
+    Buffer(internal::LogLevel::TRACE, [](std::string& buffer) {
+      buffer.append(internal::BINARY_LOG_MAGIC,
+                    sizeof(internal::BINARY_LOG_MAGIC));
+      internal::AppendBinary(buffer, internal::BINARY_LOG_VERSION);
+      internal::AppendBinary(
+          buffer, static_cast<std::int64_t>(
+                      internal::LogClock::Start().time_since_epoch().count()));
+    });
+  }
+
+  void Write(internal::Log const& log, std::string_view) override {
+    auto const descriptor = log.args.Descriptor();
+    if (!descriptor) {
+      return;
+    }
+    auto const format = log.args.FormatString();
+    std::string_view const args(
+        reinterpret_cast<char const*>(log.args.Data()), log.args.Size());
+
+    auto const time = static_cast<std::uint64_t>(
+        internal::LogClock::Uptime(log.time).count());
+    Buffer(log.level, [&](std::string& buffer) {
+      auto const component = ComponentId(buffer, log.component);
+      auto const layout = LayoutId(buffer, log.layout);
+      auto const formatId = FormatId(buffer, format, descriptor);
+      internal::AppendBinary(buffer, internal::BinaryRecord::LOG);
+      internal::AppendBinary(buffer, time);
+      internal::AppendBinary(buffer, log.seq);
+      internal::AppendBinary(buffer, log.thread);
+      internal::AppendBinary(buffer, static_cast<std::uint8_t>(log.level));
+      internal::AppendBinary(buffer, component);
+      internal::AppendBinary(buffer, layout);
+      internal::AppendBinary(buffer, formatId);
+      internal::AppendBinary(buffer, args);
+    });
+  }
+
+  bool NeedsFormatting() const override { return false; }
+
+ private:
+  // The rest are only used while holding the buffer's lock
+
+  // Ids are the process' handles, which are only meaningful in this file once
+  // they have been written
+  std::vector<bool> writtenComponents_;
+  std::vector<bool> writtenLayouts_;
+  // Keyed by format string, then by argument types as the same format string
+  // can be used with different arguments
+  std::unordered_map<
+      std::string,
+      std::vector<std::pair<internal::FormatDescriptor const*, std::uint32_t>>,
+      internal::TransparentStringHash, std::equal_to<>>
+      formats_;
+  std::uint32_t formatCount_ = 0;
+
+  // Marks id as written, returning true if it had not been already
+  static bool FirstUse(std::vector<bool>& written, std::uint32_t const id) {
+    if (id >= written.size()) {
+      written.resize(id + 1);
+    }
+    if (written[id]) {
+      return false;
+    }
+    written[id] = true;
+    return true;
+  }
+
+  std::uint32_t ComponentId(std::string& buffer, std::uint32_t const id) {
+    if (FirstUse(writtenComponents_, id)) {
+      internal::AppendBinary(buffer, internal::BinaryRecord::COMPONENT);
+      internal::AppendBinary(buffer, id);
+      internal::AppendBinary(
+          buffer, std::string_view(internal::componentNames.Get(id)));
+    }
+    return id;
+  }
+
+  std::uint32_t LayoutId(std::string& buffer, std::uint32_t const id) {
+    if (FirstUse(writtenLayouts_, id)) {
+      internal::AppendBinary(buffer, internal::BinaryRecord::LAYOUT);
+      internal::AppendBinary(buffer, id);
+      internal::AppendBinary(
+          buffer, std::string_view(internal::logLayouts.Get(id).Pattern()));
+    }
+    return id;
+  }
+
+  std::uint32_t FormatId(std::string& buffer, std::string_view const format,
+                         internal::FormatDescriptor const* descriptor) {
+    auto existing = formats_.find(format);
+    if (existing == formats_.end()) {
+      existing = formats_.try_emplace(std::string(format)).first;
+    }
+    for (auto const& [known, id] : existing->second) {
+      if (known == descriptor) {
+        return id;
+      }
+    }
+
+    auto const id = formatCount_++;
+    existing->second.emplace_back(descriptor, id);
+    internal::AppendBinary(buffer, internal::BinaryRecord::FORMAT);
+    internal::AppendBinary(buffer, id);
+    internal::AppendBinary(buffer,
+                           static_cast<std::uint8_t>(descriptor->count));
+    for (std::size_t i = 0; i < descriptor->count; ++i) {
+      internal::AppendBinary(buffer, descriptor->types[i]);
+    }
+    internal::AppendBinary(buffer, format);
+    return id;
+  }
+};
+
+namespace internal {
+
+// Turns the records written by a BinarySink back into text
+class BinaryLogDecoder {
+ public:
+  bool Decode(std::istream& in, std::ostream& out) {
+    char magic[sizeof(BINARY_LOG_MAGIC)];
+    std::uint32_t version;
+    std::int64_t start;
+    BinaryReader reader(in);
+    if (!in.read(magic, sizeof(magic)) ||
+        std::memcmp(magic, BINARY_LOG_MAGIC, sizeof(magic)) != 0 ||
+        !reader.Read(version) || version != BINARY_LOG_VERSION ||
+        !reader.Read(start)) {
+      return false;
+    }
+    start_ = LogDate(std::chrono::nanoseconds(start));
+
+    BinaryRecord record;
+    while (reader.Read(record)) {
+      auto const decoded = [&]() {
+        switch (record) {
+          case BinaryRecord::COMPONENT:
+            return ReadComponent(reader);
+          case BinaryRecord::LAYOUT:
+            return ReadLayout(reader);
+          case BinaryRecord::FORMAT:
+            return ReadFormat(reader);
+          case BinaryRecord::LOG:
+            return ReadLog(reader, out);
+        }
+        return false;
+      }();
+      if (!decoded) {
+        return false;
+      }
+    }
+    return in.eof();
+  }
+
+ private:
+  struct Format {
+    std::vector<LogArgType> types;
+    std::string format;
+  };
+
+  // File ids mapped to this process' handles
+  std::unordered_map<std::uint32_t, std::uint32_t> components_;
+  std::unordered_map<std::uint32_t, std::uint32_t> layouts_;
+  std::unordered_map<std::uint32_t, Format> formats_;
+  LogDate start_;
+  std::string text_;
+  std::string args_;
+
+  bool ReadComponent(BinaryReader& reader) {
+    std::uint32_t id;
+    if (!reader.Read(id) || !reader.Read(text_)) {
+      return false;
+    }
+    components_[id] = componentNames.Intern(
+        text_, [](std::string const& name) { return name; });
+    return true;
+  }
+
+  bool ReadLayout(BinaryReader& reader) {
+    std::uint32_t id;
+    if (!reader.Read(id) || !reader.Read(text_)) {
+      return false;
+    }
+    layouts_[id] = logLayouts.Intern(
+        text_, [](std::string const& pattern) { return LogLayout(pattern); });
+    return true;
+  }
+
+  bool ReadFormat(BinaryReader& reader) {
+    std::uint32_t id;
+    std::uint8_t count;
+    if (!reader.Read(id) || !reader.Read(count)) {
+      return false;
+    }
+    Format format;
+    format.types.resize(count);
+    for (auto& type : format.types) {
+      if (!reader.Read(type) || type > LogArgType::POINTER) {
+        return false;
+      }
+    }
+    if (!reader.Read(format.format)) {
+      return false;
+    }
+    formats_[id] = std::move(format);
+    return true;
+  }
+
+  bool ReadLog(BinaryReader& reader, std::ostream& out) {
+    Log log{};
+    std::uint64_t time;
+    std::uint8_t level;
+    std::uint32_t component, layout, format;
+    if (!reader.Read(time) || !reader.Read(log.seq) ||
+        !reader.Read(log.thread) || !reader.Read(level) ||
+        !reader.Read(component) || !reader.Read(layout) ||
+        !reader.Read(format) || !reader.Read(args_) ||
+        level > static_cast<std::uint8_t>(LogLevel::TRACE) ||
+        !components_.contains(component) || !layouts_.contains(layout) ||
+        !formats_.contains(format)) {
+      return false;
+    }
+    log.level = static_cast<LogLevel>(level);
+    log.component = components_.at(component);
+    log.layout = layouts_.at(layout);
+
+    fmt::memory_buffer message;
+    if (!FormatArgs(message, formats_.at(format))) {
+      return false;
+    }
+    std::chrono::nanoseconds const uptime(time);
+    fmt::memory_buffer line;
+    logLayouts.Get(log.layout)
+        .Format(line, log, {uptime, start_ + uptime},
+                std::string_view(message.data(), message.size()));
+    out.write(line.data(), line.size()).put('\n');
+    return true;
+  }
+
+  // The types are only known at runtime here so the arguments go through a
+  // dynamic argument store. Returns false if args_ is too short for them
+  bool FormatArgs(fmt::memory_buffer& out, Format const& format) const {
+    fmt::dynamic_format_arg_store<fmt::format_context> store;
+    auto const data = reinterpret_cast<std::byte const*>(args_.data());
+    std::size_t offset = 0;
+    for (auto const type : format.types) {
+      LogArgReader reader(data + offset);
+      auto const available = args_.size() - offset;
+      if (type == LogArgType::STRING) {
+        if (available < sizeof(std::uint64_t)) {
+          return false;
+        }
+        std::uint64_t size;
+        std::memcpy(&size, data + offset, sizeof(size));
+        if (available - sizeof(size) < size) {
+          return false;
+        }
+        store.push_back(reader.Read<LogArgType::STRING>());
+        offset += sizeof(size) + size;
+        continue;
+      }
+      auto const size = ArgSize(type);
+      if (available < size) {
+        return false;
+      }
+      Push(store, reader, type);
+      offset += size;
+    }
+    try {
+      fmt::vformat_to(
+          fmt::appender(out),
+          fmt::string_view(format.format.data(), format.format.size()),
+          store);
+    } catch (fmt::format_error const& error) {
+      out.clear();
+      fmt::format_to(fmt::appender(out), "[format error: {}]", error.what());
+    }
+    return true;
+  }
+
+  static std::size_t ArgSize(LogArgType const type) {
+    switch (type) {
+      case LogArgType::BOOL:
+        return sizeof(LogArgStorageT<LogArgType::BOOL>);
+      case LogArgType::CHAR:
+        return sizeof(LogArgStorageT<LogArgType::CHAR>);
+      case LogArgType::INT:
+        return sizeof(LogArgStorageT<LogArgType::INT>);
+      case LogArgType::UINT:
+        return sizeof(LogArgStorageT<LogArgType::UINT>);
+      case LogArgType::FLOAT:
+        return sizeof(LogArgStorageT<LogArgType::FLOAT>);
+      case LogArgType::DOUBLE:
+        return sizeof(LogArgStorageT<LogArgType::DOUBLE>);
+      case LogArgType::STRING:
+        return sizeof(std::uint64_t);
+      case LogArgType::POINTER:
+        return sizeof(LogArgStorageT<LogArgType::POINTER>);
+    }
+    return 0;
+  }
+
+  // For everything but strings
+  static void Push(fmt::dynamic_format_arg_store<fmt::format_context>& store,
+                   LogArgReader& reader, LogArgType const type) {
+    switch (type) {
+      case LogArgType::BOOL:
+        store.push_back(reader.Read<LogArgType::BOOL>());
+        break;
+      case LogArgType::CHAR:
+        store.push_back(reader.Read<LogArgType::CHAR>());
+        break;
+      case LogArgType::INT:
+        store.push_back(reader.Read<LogArgType::INT>());
+        break;
+      case LogArgType::UINT:
+        store.push_back(reader.Read<LogArgType::UINT>());
+        break;
+      case LogArgType::FLOAT:
+        store.push_back(reader.Read<LogArgType::FLOAT>());
+        break;
+      case LogArgType::DOUBLE:
+        store.push_back(reader.Read<LogArgType::DOUBLE>());
+        break;
+      case LogArgType::POINTER:
+        store.push_back(reader.Read<LogArgType::POINTER>());
+        break;
+      case LogArgType::STRING:
+        break;
+    }
+  }
+};
+
+}  // namespace internal
+
+// Turns a log written by BinarySink back into text, one line per log using
+// the layout each log was written with. Returns false if the input is not a
+// binary log or is cut short, after writing out every complete log
+inline bool DecodeBinaryLog(std::istream& in, std::ostream& out) {
+  return internal::BinaryLogDecoder().Decode(in, out);
+}
+
+}  // namespace async_lib
+
+#endif  // ASYNC_LIB_BINARY_LOG_HPP
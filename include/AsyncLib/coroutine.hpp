@@ -0,0 +1,320 @@
+#ifndef ASYNC_LIB_COROUTINE_HPP
+#define ASYNC_LIB_COROUTINE_HPP
+
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include "AsyncLib/queue.hpp"
+
+namespace async_lib {
+
+template <class T = void>
+class Task;
+
+namespace internal {
+
+class TaskPromiseBase {
+ public:
+  struct FinalAwaiter {
+    bool await_ready() const noexcept { return false; }
+    // Symmetric transfer so long chains of tasks do not grow the stack
+    template <class Promise>
+    std::coroutine_handle<> await_suspend(
+        std::coroutine_handle<Promise> handle) noexcept {
+      return handle.promise().continuation_;
+    }
+    void await_resume() const noexcept {}
+  };
+
+  std::suspend_always initial_suspend() const noexcept { return {}; }
+  FinalAwaiter final_suspend() const noexcept { return {}; }
+  void unhandled_exception() { exception_ = std::current_exception(); }
+
+  void SetContinuation(std::coroutine_handle<> continuation) {
+    continuation_ = continuation;
+  }
+
+ protected:
+  std::coroutine_handle<> continuation_ = std::noop_coroutine();
+  std::exception_ptr exception_;
+
+  void RethrowException() const {
+    if (exception_) {
+      std::rethrow_exception(exception_);
+    }
+  }
+};
+
+template <class T>
+class TaskPromise : public TaskPromiseBase {
+ public:
+  Task<T> get_return_object();
+
+  template <class U>
+  void return_value(U&& value) {
+    value_.emplace(std::forward<U>(value));
+  }
+
+  T Result() {
+    RethrowException();
+    return std::move(*value_);
+  }
+
+ private:
+  std::optional<T> value_;
+};
+
+template <>
+class TaskPromise<void> : public TaskPromiseBase {
+ public:
+  Task<void> get_return_object();
+
+  void return_void() const {}
+
+  void Result() const { RethrowException(); }
+};
+
+// Fire and forget coroutine that runs straight away and cleans itself up
+struct DetachedTask {
+  struct promise_type {
+    DetachedTask get_return_object() const { return {}; }
+    std::suspend_never initial_suspend() const noexcept { return {}; }
+    std::suspend_never final_suspend() const noexcept { return {}; }
+    void return_void() const {}
+    void unhandled_exception() const { std::terminate(); }
+  };
+};
+
+}  // namespace internal
+
+// Lazily started coroutine producing a T. Nothing runs until it is awaited
+// (or passed to SyncWait), at which point the awaiting coroutine is resumed
+// once it completes, on whichever thread completed it. Exceptions are passed
+// on to the awaiting coroutine
+template <class T>
+class [[nodiscard]] Task {
+  static_assert(!std::is_reference_v<T>, "Task cannot return a reference");
+
+ public:
+  typedef internal::TaskPromise<T> promise_type;
+
+  explicit Task(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+  ~Task() {
+    if (handle_) {
+      handle_.destroy();
+    }
+  }
+
+  Task(Task const&) = delete;
+  Task& operator=(Task const&) = delete;
+  Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+  Task& operator=(Task&& other) noexcept {
+    if (this != &other) {
+      if (handle_) {
+        handle_.destroy();
+      }
+      handle_ = std::exchange(other.handle_, {});
+    }
+    return *this;
+  }
+
+  auto operator co_await() && noexcept {
+    struct Awaiter {
+      std::coroutine_handle<promise_type> handle;
+
+      bool await_ready() const noexcept { return handle.done(); }
+      std::coroutine_handle<> await_suspend(
+          std::coroutine_handle<> awaiting) noexcept {
+        handle.promise().SetContinuation(awaiting);
+        return handle;
+      }
+      T await_resume() { return handle.promise().Result(); }
+    };
+    return Awaiter{handle_};
+  }
+
+ private:
+  std::coroutine_handle<promise_type> handle_;
+};
+
+namespace internal {
+
+template <class T>
+Task<T> TaskPromise<T>::get_return_object() {
+  return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() {
+  return Task<void>(
+      std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+}  // namespace internal
+
+// Runs task and blocks the calling thread until it completes. This is the
+// bridge from normal code into coroutines so should not be called from a
+// thread the task needs in order to finish
+template <class T>
+T SyncWait(Task<T> task) {
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool done = false;
+  std::exception_ptr exception;
+  std::conditional_t<std::is_void_v<T>, bool, std::optional<T>> result{};
+
+  auto run = [&]() -> internal::DetachedTask {
+    try {
+      if constexpr (std::is_void_v<T>) {
+        co_await std::move(task);
+      } else {
+        result.emplace(co_await std::move(task));
+      }
+    } catch (...) {
+      exception = std::current_exception();
+    }
+    // Notify while holding the lock so we cannot return (and destroy the
+    // condition variable) before the notify has finished with it
+    std::unique_lock lock(mutex);
+    done = true;
+    cv.notify_one();
+  };
+  run();
+
+  std::unique_lock lock(mutex);
+  cv.wait(lock, [&]() { return done; });
+  if (exception) {
+    std::rethrow_exception(exception);
+  }
+  if constexpr (!std::is_void_v<T>) {
+    return std::move(*result);
+  }
+}
+
+// Suspends the current coroutine and resumes it on one of worker's threads.
+// Works with anything providing Submit(callable) -> bool such as TaskWorker.
+// If the worker refuses the job the coroutine carries on on this thread
+template <class WorkerT>
+auto ScheduleOn(WorkerT& worker) {
+  struct Awaiter {
+    WorkerT& worker;
+
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<> handle) {
+      return worker.Submit([handle]() { handle.resume(); });
+    }
+    void await_resume() const noexcept {}
+  };
+  return Awaiter{worker};
+}
+
+// Queue that coroutines can wait on without blocking a thread. PopAsync
+// suspends the coroutine until data is pushed, and Push hands the data
+// straight to the oldest waiting coroutine and resumes it on the pushing
+// thread
+template <class T, const std::size_t SIZE = DEFAULT_QUEUE_SIZE>
+class AsyncQueue {
+ public:
+  class PopAwaiter {
+   public:
+    explicit PopAwaiter(AsyncQueue& queue) : queue_(queue) {}
+
+    bool await_ready() { return queue_.TryTake(value_); }
+    bool await_suspend(std::coroutine_handle<> handle) {
+      handle_ = handle;
+      return queue_.AddWaiter(this);
+    }
+    T await_resume() { return std::move(*value_); }
+
+   private:
+    friend class AsyncQueue;
+
+    AsyncQueue& queue_;
+    std::optional<T> value_;
+    std::coroutine_handle<> handle_;
+    // Waiters form an intrusive list through their (coroutine frame owned)
+    // awaiters so waiting never allocates
+    PopAwaiter* next_ = nullptr;
+  };
+
+  AsyncQueue() = default;
+  ~AsyncQueue() = default;
+
+  AsyncQueue(AsyncQueue const&) = delete;
+  AsyncQueue& operator=(AsyncQueue const&) = delete;
+  AsyncQueue(AsyncQueue&&) = delete;
+  AsyncQueue& operator=(AsyncQueue&&) = delete;
+
+  template <class... Args>
+  void Emplace(Args&&... args) {
+    PopAwaiter* waiter;
+    {
+      std::unique_lock lock(mutex_);
+      waiter = waitersFront_;
+      if (!waiter) {
+        queue_.Emplace(std::forward<Args>(args)...);
+        return;
+      }
+      waitersFront_ = waiter->next_;
+      if (!waitersFront_) {
+        waitersBack_ = nullptr;
+      }
+    }
+    waiter->value_.emplace(std::forward<Args>(args)...);
+    waiter->handle_.resume();
+  }
+
+  void Push(T&& data) { Emplace(std::move(data)); }
+  void Push(T const& data) { Emplace(data); }
+
+  // co_await the result to get the front of the queue, suspending until there
+  // is one
+  PopAwaiter PopAsync() { return PopAwaiter(*this); }
+
+  // Returns an empty optional if the queue is empty
+  std::optional<T> TryPop() {
+    std::optional<T> data;
+    TryTake(data);
+    return data;
+  }
+
+  // Only a snapshot as other threads may be pushing/popping concurrently
+  std::size_t Size() const { return queue_.Size(); }
+
+ private:
+  Queue<T, SIZE, queue_policy::Unbounded> queue_;
+  // Guards the hand over between the queue and waiting coroutines
+  std::mutex mutex_;
+  PopAwaiter* waitersFront_ = nullptr;
+  PopAwaiter* waitersBack_ = nullptr;
+
+  bool TryTake(std::optional<T>& data) {
+    std::unique_lock lock(mutex_);
+    data = queue_.TryPop();
+    return data.has_value();
+  }
+
+  // Returns false (and takes the front) if data arrived in the meantime
+  bool AddWaiter(PopAwaiter* waiter) {
+    std::unique_lock lock(mutex_);
+    waiter->value_ = queue_.TryPop();
+    if (waiter->value_) {
+      return false;
+    }
+    if (waitersBack_) {
+      waitersBack_->next_ = waiter;
+    } else {
+      waitersFront_ = waiter;
+    }
+    waitersBack_ = waiter;
+    return true;
+  }
+};
+
+}  // namespace async_lib
+
+#endif  // ASYNC_LIB_COROUTINE_HPP
@@ -0,0 +1,133 @@
+#ifndef ASYNC_LIB_EVENT_HPP
+#define ASYNC_LIB_EVENT_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <ctime>
+#else
+#include <condition_variable>
+#include <mutex>
+#endif
+
+namespace async_lib {
+
+// Hint to the CPU that we are in a spin loop
+inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+// Lets threads sleep until another thread signals that something changed
+// without the risk of a lost wakeup. Waiters must follow the pattern:
+//
+//   auto token = event.PrepareWait();
+//   if (!condition) event.Wait(token);
+//   event.FinishWait();
+//
+// and notifiers must update the condition before calling Notify. Notify only
+// makes a syscall when there is actually a thread waiting. Uses a futex on
+// Linux and a condition variable elsewhere
+class Event {
+ public:
+  Event() = default;
+  ~Event() = default;
+
+  Event(Event const&) = delete;
+  Event& operator=(Event const&) = delete;
+  Event(Event&&) = delete;
+  Event& operator=(Event&&) = delete;
+
+  std::uint32_t PrepareWait() {
+    waiters_.fetch_add(1);
+    // Pairs with the fence in Notify so either we see the new condition or the
+    // notifier sees that we are waiting
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return epoch_.load(std::memory_order_acquire);
+  }
+
+  // Returns false if the timeout expired before being notified
+  bool Wait(std::uint32_t const token,
+            std::optional<std::chrono::nanoseconds> const timeout = {}) {
+#ifdef __linux__
+    timespec time{};
+    if (timeout) {
+      auto const seconds =
+          std::chrono::duration_cast<std::chrono::seconds>(*timeout);
+      time.tv_sec = seconds.count();
+      time.tv_nsec = (*timeout - seconds).count();
+    }
+    auto const result = syscall(SYS_futex, FutexAddress(), FUTEX_WAIT_PRIVATE,
+                                token, timeout ? &time : nullptr, nullptr, 0);
+    return !(result == -1 && errno == ETIMEDOUT);
+#else
+    std::unique_lock lock(mutex_);
+    auto const notified = [&]() { return epoch_.load() != token; };
+    if (timeout) {
+      return cv_.wait_for(lock, *timeout, notified);
+    }
+    cv_.wait(lock, notified);
+    return true;
+#endif
+  }
+
+  void FinishWait() { waiters_.fetch_sub(1, std::memory_order_relaxed); }
+
+  void NotifyOne() { Notify(1); }
+  void NotifyAll() { Notify(INT32_MAX); }
+
+  std::uint32_t Waiters() const {
+    return waiters_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic_uint32_t epoch_{0};
+  std::atomic_uint32_t waiters_{0};
+#ifndef __linux__
+  std::mutex mutex_;
+  std::condition_variable cv_;
+#endif
+
+  void Notify(std::int32_t const count) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters_.load(std::memory_order_relaxed) == 0) {
+      return;
+    }
+    epoch_.fetch_add(1);
+#ifdef __linux__
+    syscall(SYS_futex, FutexAddress(), FUTEX_WAKE_PRIVATE, count, nullptr,
+            nullptr, 0);
+#else
+    // Taking the lock ensures a waiter is either asleep or will see the epoch
+    { std::unique_lock lock(mutex_); }
+    if (count == 1) {
+      cv_.notify_one();
+    } else {
+      cv_.notify_all();
+    }
+#endif
+  }
+
+#ifdef __linux__
+  std::uint32_t* FutexAddress() {
+    static_assert(sizeof(epoch_) == sizeof(std::uint32_t) &&
+                  std::atomic_uint32_t::is_always_lock_free);
+    return reinterpret_cast<std::uint32_t*>(&epoch_);
+  }
+#endif
+};
+
+}  // namespace async_lib
+
+#endif  // ASYNC_LIB_EVENT_HPP
@@ -0,0 +1,425 @@
+#ifndef ASYNC_LIB_FUTURE_HPP
+#define ASYNC_LIB_FUTURE_HPP
+
+#include <assert.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "AsyncLib/event.hpp"
+#include "AsyncLib/inplace_function.hpp"
+#include "AsyncLib/queue.hpp"
+
+namespace async_lib {
+
+// Room for a continuation created by Then: the function plus a promise and a
+// pointer back to the state. Continuations that need more are heap allocated
+constexpr std::size_t FUTURE_CONTINUATION_SIZE = 64;
+
+template <class T>
+class Future;
+
+template <class T>
+class Promise;
+
+namespace internal {
+
+// Recycles fixed size blocks through a lock-free free list so repeatedly
+// creating futures does not keep going back to the system allocator
+template <const std::size_t SIZE, const std::size_t ALIGNMENT>
+class BlockPool {
+ public:
+  static constexpr std::size_t MAX_FREE_BLOCKS = 1024;
+
+  static void* Allocate() {
+    if (auto block = Instance().freeBlocks_.TryPop()) {
+      return *block;
+    }
+    return ::operator new(SIZE, std::align_val_t{ALIGNMENT});
+  }
+
+  static void Deallocate(void* block) {
+    if (!Instance().freeBlocks_.TryPush(block)) {
+      ::operator delete(block, std::align_val_t{ALIGNMENT});
+    }
+  }
+
+ private:
+  Queue<void*, MAX_FREE_BLOCKS, queue_policy::MPMC> freeBlocks_;
+
+  BlockPool() = default;
+  ~BlockPool() {
+    while (auto block = freeBlocks_.TryPop()) {
+      ::operator delete(*block, std::align_val_t{ALIGNMENT});
+    }
+  }
+
+  static BlockPool& Instance() {
+    static BlockPool pool;
+    return pool;
+  }
+};
+
+// Allocator for std::allocate_shared so the shared state and its control
+// block come from a BlockPool
+template <class T>
+class PoolAllocator {
+ public:
+  typedef T value_type;
+
+  PoolAllocator() = default;
+  template <class U>
+  PoolAllocator(PoolAllocator<U> const&) {}
+
+  T* allocate(std::size_t const count) {
+    if (count != 1) {
+      return std::allocator<T>().allocate(count);
+    }
+    return static_cast<T*>(BlockPool<sizeof(T), alignof(T)>::Allocate());
+  }
+
+  void deallocate(T* pointer, std::size_t const count) {
+    if (count != 1) {
+      std::allocator<T>().deallocate(pointer, count);
+      return;
+    }
+    BlockPool<sizeof(T), alignof(T)>::Deallocate(pointer);
+  }
+
+  template <class U>
+  bool operator==(PoolAllocator<U> const&) const {
+    return true;
+  }
+};
+
+// Shared between a Promise and its Future. The value and continuation are
+// handed over with a single atomic flag so no lock is needed: whichever of
+// the promise and Then sets its flag second runs the continuation
+template <class T>
+class FutureState : public std::enable_shared_from_this<FutureState<T>> {
+ public:
+  typedef std::conditional_t<std::is_void_v<T>, std::monostate, T> ValueT;
+  typedef InplaceFunction<void(), FUTURE_CONTINUATION_SIZE> ContinuationT;
+
+  template <class... Args>
+  void SetValue(Args&&... args) {
+    value_.emplace(std::forward<Args>(args)...);
+    Complete();
+  }
+
+  void SetException(std::exception_ptr exception) {
+    exception_ = exception;
+    Complete();
+  }
+
+  bool IsReady() const {
+    return flags_.load(std::memory_order_acquire) & READY;
+  }
+
+  // Returns false if the deadline passed first
+  bool Wait(std::optional<std::chrono::steady_clock::time_point> const
+                deadline = {}) {
+    while (!IsReady()) {
+      auto const token = event_.PrepareWait();
+      auto woken = IsReady();
+      if (!woken && deadline) {
+        auto const remaining = *deadline - std::chrono::steady_clock::now();
+        woken = remaining.count() > 0 && event_.Wait(token, remaining);
+      } else if (!woken) {
+        woken = event_.Wait(token);
+      }
+      event_.FinishWait();
+      if (!woken) {
+        return IsReady();
+      }
+    }
+    return true;
+  }
+
+  void SetContinuation(ContinuationT&& continuation) {
+    continuation_ = std::move(continuation);
+    if (flags_.fetch_or(HAS_CONTINUATION, std::memory_order_acq_rel) & READY) {
+      continuation_();
+    }
+  }
+
+  // Must only be called once ready
+  ValueT TakeValue() {
+    if (exception_) {
+      std::rethrow_exception(exception_);
+    }
+    return std::move(*value_);
+  }
+
+ private:
+  static constexpr std::uint32_t READY = 1;
+  static constexpr std::uint32_t HAS_CONTINUATION = 2;
+
+  std::atomic_uint32_t flags_{0};
+  std::optional<ValueT> value_;
+  std::exception_ptr exception_;
+  ContinuationT continuation_;
+  Event event_;
+
+  void Complete() {
+    auto const flags = flags_.fetch_or(READY, std::memory_order_acq_rel);
+    assert(!(flags & READY) && "Promise has already been satisfied");
+    if (flags & HAS_CONTINUATION) {
+      continuation_();
+    }
+    event_.NotifyAll();
+  }
+};
+
+template <class T>
+std::shared_ptr<FutureState<T>> MakeFutureState() {
+  return std::allocate_shared<FutureState<T>>(
+      PoolAllocator<FutureState<T>>{});
+}
+
+// Calls function with args and stores the result (or exception) in promise
+template <class R, class Function, class... Args>
+void SetPromise(Promise<R>& promise, Function& function, Args&&... args) {
+  try {
+    if constexpr (std::is_void_v<R>) {
+      std::invoke(function, std::forward<Args>(args)...);
+      promise.SetValue();
+    } else {
+      promise.SetValue(std::invoke(function, std::forward<Args>(args)...));
+    }
+  } catch (...) {
+    promise.SetException(std::current_exception());
+  }
+}
+
+}  // namespace internal
+
+// Write end of a Future. If it is destroyed without a value being set the
+// future holds a std::future_error with broken_promise instead
+template <class T>
+class Promise {
+ public:
+  Promise() : state_(internal::MakeFutureState<T>()) {}
+  ~Promise() {
+    if (state_ && !state_->IsReady()) {
+      SetException(std::make_exception_ptr(
+          std::future_error(std::future_errc::broken_promise)));
+    }
+  }
+
+  Promise(Promise const&) = delete;
+  Promise& operator=(Promise const&) = delete;
+  Promise(Promise&&) noexcept = default;
+  Promise& operator=(Promise&&) noexcept = default;
+
+  // Should only be called once
+  Future<T> GetFuture() { return Future<T>(state_); }
+
+  template <class... Args>
+  void SetValue(Args&&... args) {
+    state_->SetValue(std::forward<Args>(args)...);
+  }
+
+  void SetException(std::exception_ptr exception) {
+    state_->SetException(exception);
+  }
+
+ private:
+  std::shared_ptr<internal::FutureState<T>> state_;
+};
+
+// Lighter weight std::future. The shared state comes from a pool, setting the
+// value never takes a lock and continuations can be chained with Then
+template <class T>
+class Future {
+ public:
+  Future() = default;
+  explicit Future(std::shared_ptr<internal::FutureState<T>> state)
+      : state_(std::move(state)) {}
+
+  Future(Future const&) = delete;
+  Future& operator=(Future const&) = delete;
+  Future(Future&&) noexcept = default;
+  Future& operator=(Future&&) noexcept = default;
+
+  // False once Get, Then or OnReady has been called
+  bool Valid() const { return state_ != nullptr; }
+  bool IsReady() const { return state_->IsReady(); }
+
+  void Wait() const { state_->Wait(); }
+
+  // Returns false if the timeout expired before the future was ready
+  template <class Rep, class Period>
+  bool WaitFor(std::chrono::duration<Rep, Period> const timeout) const {
+    return state_->Wait(std::chrono::steady_clock::now() + timeout);
+  }
+
+  // Blocks until ready and returns the value, or throws the stored exception
+  T Get() {
+    state_->Wait();
+    auto state = std::move(state_);
+    if constexpr (std::is_void_v<T>) {
+      state->TakeValue();
+    } else {
+      return state->TakeValue();
+    }
+  }
+
+  // Calls function with this (now ready) future once it has a value or
+  // exception. It runs on the thread that sets the value, or straight away if
+  // that has already happened
+  template <class Function>
+  void OnReady(Function&& function) {
+    auto state = std::move(state_);
+    auto raw = state.get();
+    raw->SetContinuation(
+        [raw, function = std::forward<Function>(function)]() mutable {
+          function(Future(raw->shared_from_this()));
+        });
+  }
+
+  // Returns a future for function called with the value of this one. If this
+  // future holds an exception function is skipped and the exception passed on
+  template <class Function>
+  auto Then(Function&& function) {
+    typedef typename std::conditional_t<
+        std::is_void_v<T>, std::invoke_result<std::decay_t<Function>&>,
+        std::invoke_result<std::decay_t<Function>&, T>>::type R;
+    Promise<R> promise;
+    auto future = promise.GetFuture();
+    OnReady([promise = std::move(promise),
+             function = std::forward<Function>(function)](
+                Future ready) mutable {
+      try {
+        if constexpr (std::is_void_v<T>) {
+          ready.Get();
+          internal::SetPromise(promise, function);
+        } else {
+          internal::SetPromise(promise, function, ready.Get());
+        }
+      } catch (...) {
+        promise.SetException(std::current_exception());
+      }
+    });
+    return future;
+  }
+
+ private:
+  std::shared_ptr<internal::FutureState<T>> state_;
+};
+
+// Ready once all futures are, holding their values in order (or nothing for
+// void). If any of them fail it holds the first exception instead
+template <class T>
+auto WhenAll(std::vector<Future<T>> futures) {
+  typedef std::conditional_t<std::is_void_v<T>, void, std::vector<T>> R;
+  struct State {
+    Promise<R> promise;
+    std::vector<std::optional<typename internal::FutureState<T>::ValueT>>
+        values;
+    std::atomic_size_t remaining;
+    std::atomic_bool failed{false};
+    std::exception_ptr exception;
+
+    explicit State(std::size_t const count)
+        : values(std::is_void_v<T> ? 0 : count), remaining(count) {}
+
+    void Finish() {
+      if (exception) {
+        promise.SetException(exception);
+      } else if constexpr (std::is_void_v<T>) {
+        promise.SetValue();
+      } else {
+        std::vector<T> results;
+        results.reserve(values.size());
+        for (auto& value : values) {
+          results.push_back(std::move(*value));
+        }
+        promise.SetValue(std::move(results));
+      }
+    }
+  };
+
+  auto state = std::allocate_shared<State>(internal::PoolAllocator<State>{},
+                                           futures.size());
+  auto future = state->promise.GetFuture();
+  if (futures.empty()) {
+    state->Finish();
+    return future;
+  }
+  for (std::size_t i = 0; i < futures.size(); ++i) {
+    futures[i].OnReady([state, i](Future<T> ready) {
+      try {
+        if constexpr (std::is_void_v<T>) {
+          ready.Get();
+        } else {
+          state->values[i].emplace(ready.Get());
+        }
+      } catch (...) {
+        if (!state->failed.exchange(true)) {
+          state->exception = std::current_exception();
+        }
+      }
+      // The last one to finish publishes the results
+      if (state->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        state->Finish();
+      }
+    });
+  }
+  return future;
+}
+
+// Ready once the first of futures is, holding its index and value (just the
+// index for void) or its exception. At least one future must be given
+template <class T>
+auto WhenAny(std::vector<Future<T>> futures) {
+  typedef std::conditional_t<std::is_void_v<T>, std::size_t,
+                             std::pair<std::size_t, T>>
+      R;
+  struct State {
+    Promise<R> promise;
+    std::atomic_bool done{false};
+  };
+
+  auto state = std::allocate_shared<State>(internal::PoolAllocator<State>{});
+  auto future = state->promise.GetFuture();
+  if (futures.empty()) {
+    state->promise.SetException(std::make_exception_ptr(
+        std::invalid_argument("WhenAny needs at least one future")));
+    return future;
+  }
+  for (std::size_t i = 0; i < futures.size(); ++i) {
+    futures[i].OnReady([state, i](Future<T> ready) {
+      if (state->done.exchange(true)) {
+        return;
+      }
+      try {
+        if constexpr (std::is_void_v<T>) {
+          ready.Get();
+          state->promise.SetValue(i);
+        } else {
+          state->promise.SetValue(i, ready.Get());
+        }
+      } catch (...) {
+        state->promise.SetException(std::current_exception());
+      }
+    });
+  }
+  return future;
+}
+
+}  // namespace async_lib
+
+#endif  // ASYNC_LIB_FUTURE_HPP
@@ -0,0 +1,128 @@
+#ifndef ASYNC_LIB_INPLACE_FUNCTION_HPP
+#define ASYNC_LIB_INPLACE_FUNCTION_HPP
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace async_lib {
+
+// Enough for a lambda capturing a handful of pointers/values while keeping the
+// whole InplaceFunction within a single cache line
+constexpr std::size_t DEFAULT_INPLACE_FUNCTION_SIZE = 48;
+
+template <class Signature,
+          const std::size_t CAPACITY = DEFAULT_INPLACE_FUNCTION_SIZE>
+class InplaceFunction;
+
+// Move-only replacement for std::function that stores the callable in an
+// inline buffer of CAPACITY bytes, so it does not allocate. Callables that do
+// not fit (or are over-aligned) are moved to the heap instead
+template <class R, class... Args, const std::size_t CAPACITY>
+class InplaceFunction<R(Args...), CAPACITY> {
+ public:
+  InplaceFunction() = default;
+  InplaceFunction(std::nullptr_t) {}
+
+  template <class Function,
+            class = std::enable_if_t<
+                !std::is_same_v<std::decay_t<Function>, InplaceFunction> &&
+                std::is_invocable_r_v<R, std::decay_t<Function>&, Args...>>>
+  InplaceFunction(Function&& function) {
+    typedef std::decay_t<Function> FunctionT;
+    if constexpr (FITS_INLINE<FunctionT>) {
+      ::new (storage_) FunctionT(std::forward<Function>(function));
+      vtable_ = &VTABLE<FunctionT>;
+    } else {
+      ::new (storage_) Boxed<FunctionT>{
+          std::make_unique<FunctionT>(std::forward<Function>(function))};
+      vtable_ = &VTABLE<Boxed<FunctionT>>;
+    }
+  }
+
+  // Whether a callable is stored in the inline buffer
+  template <class FunctionT>
+  static constexpr bool FITS_INLINE =
+      sizeof(FunctionT) <= CAPACITY &&
+      alignof(FunctionT) <= alignof(std::max_align_t);
+
+  ~InplaceFunction() { Reset(); }
+
+  InplaceFunction(InplaceFunction const&) = delete;
+  InplaceFunction& operator=(InplaceFunction const&) = delete;
+
+  InplaceFunction(InplaceFunction&& other) noexcept { MoveFrom(other); }
+  InplaceFunction& operator=(InplaceFunction&& other) noexcept {
+    if (this != &other) {
+      Reset();
+      MoveFrom(other);
+    }
+    return *this;
+  }
+
+  InplaceFunction& operator=(std::nullptr_t) {
+    Reset();
+    return *this;
+  }
+
+  R operator()(Args... args) {
+    return vtable_->invoke(storage_, std::forward<Args>(args)...);
+  }
+
+  explicit operator bool() const { return vtable_ != nullptr; }
+
+ private:
+  struct VTable {
+    R (*invoke)(void*, Args&&...);
+    void (*move)(void* destination, void* source);
+    void (*destroy)(void*);
+  };
+
+  // Holds a callable too large for the buffer, which only needs the pointer
+  template <class FunctionT>
+  struct Boxed {
+    std::unique_ptr<FunctionT> function;
+
+    R operator()(Args&&... args) {
+      return std::invoke(*function, std::forward<Args>(args)...);
+    }
+  };
+
+  template <class StoredT>
+  static constexpr VTable VTABLE{
+      [](void* storage, Args&&... args) -> R {
+        return std::invoke(*static_cast<StoredT*>(storage),
+                           std::forward<Args>(args)...);
+      },
+      [](void* destination, void* source) {
+        ::new (destination) StoredT(std::move(*static_cast<StoredT*>(source)));
+        static_cast<StoredT*>(source)->~StoredT();
+      },
+      [](void* storage) { static_cast<StoredT*>(storage)->~StoredT(); }};
+
+  alignas(std::max_align_t) std::byte storage_[CAPACITY];
+  VTable const* vtable_ = nullptr;
+
+  void Reset() {
+    if (vtable_) {
+      vtable_->destroy(storage_);
+      vtable_ = nullptr;
+    }
+  }
+
+  // Leaves other empty
+  void MoveFrom(InplaceFunction& other) {
+    if (other.vtable_) {
+      other.vtable_->move(storage_, other.storage_);
+      vtable_ = other.vtable_;
+      other.vtable_ = nullptr;
+    }
+  }
+};
+
+}  // namespace async_lib
+
+#endif  // ASYNC_LIB_INPLACE_FUNCTION_HPP
@@ -1,24 +1,68 @@
 #ifndef ASYNC_LIB_LOGGER_HPP
 #define ASYNC_LIB_LOGGER_HPP
 
+#include <assert.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <iterator>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <shared_mutex>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
 #include <unordered_map>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define ASYNC_LIB_HAS_TSC 1
+#else
+#define ASYNC_LIB_HAS_TSC 0
+#endif
 
 #include "AsyncLib/worker.hpp"
+#include "fmt/chrono.h"
 #include "fmt/format.h"
 
+// Levels above this are compiled out: 2 keeps errors, 3 warnings, 4 info, 5
+// debug and 6 trace. Everything is compiled in by default so that verbose
+// logging can be turned on at runtime with SetLogLevel
 #ifndef LOG_LEVEL
-#ifdef NDEBUG
-#define LOG_LEVEL 2
-#else
-#define LOG_LEVEL 4
+#define LOG_LEVEL 6
 #endif
+
+// Define LOG_COARSE_CLOCK to timestamp logs with CLOCK_MONOTONIC_COARSE on
+// Linux. It only moves every few milliseconds, but is cheap to read even on
+// machines without a usable TSC
+
+// How many logs each backend thread can have waiting before the backpressure
+// option applies (blocking by default)
+#ifndef LOG_QUEUE_SIZE
+#define LOG_QUEUE_SIZE 1024
 #endif
 
 namespace async_lib {
@@ -26,28 +70,1189 @@ namespace async_lib {
 typedef std::chrono::high_resolution_clock timer;
 
 namespace internal {
-enum class LogLevel { ERROR, WARN, INFO };
-static std::unordered_map<LogLevel, char const*> LogLevelName{
+enum class LogLevel { ERROR, WARN, INFO, DEBUG, TRACE };
+inline std::unordered_map<LogLevel, char const*> LogLevelName{
     {LogLevel::ERROR, "Error"},
     {LogLevel::WARN, "Warning"},
-    {LogLevel::INFO, "Info"}};
+    {LogLevel::INFO, "Info"},
+    {LogLevel::DEBUG, "Debug"},
+    {LogLevel::TRACE, "Trace"}};
+
+// The runtime level loggers start with, matching what was compiled in before
+// levels could be changed at runtime
+#ifdef NDEBUG
+constexpr LogLevel DEFAULT_LOG_LEVEL = LogLevel::ERROR;
+#else
+constexpr LogLevel DEFAULT_LOG_LEVEL = LogLevel::INFO;
+#endif
+
+// How each argument is stored in LogArgs
+enum class LogArgType : std::uint8_t {
+  BOOL,
+  CHAR,
+  INT,
+  UINT,
+  FLOAT,
+  DOUBLE,
+  STRING,
+  POINTER
+};
+
+// Returns nothing if T cannot be copied safely for formatting later, in which
+// case the message is formatted straight away instead
+template <class T>
+constexpr std::optional<LogArgType> GetLogArgType() {
+  typedef std::decay_t<T> U;
+  if constexpr (std::is_same_v<U, bool>) {
+    return LogArgType::BOOL;
+  } else if constexpr (std::is_same_v<U, char>) {
+    return LogArgType::CHAR;
+  } else if constexpr (std::is_same_v<U, wchar_t> ||
+                       std::is_same_v<U, char8_t> ||
+                       std::is_same_v<U, char16_t> ||
+                       std::is_same_v<U, char32_t>) {
+    return std::nullopt;
+  } else if constexpr (std::is_integral_v<U> && std::is_signed_v<U>) {
+    return LogArgType::INT;
+  } else if constexpr (std::is_integral_v<U>) {
+    return LogArgType::UINT;
+  } else if constexpr (std::is_same_v<U, float>) {
+    return LogArgType::FLOAT;
+  } else if constexpr (std::is_same_v<U, double>) {
+    return LogArgType::DOUBLE;
+  } else if constexpr (std::is_same_v<U, char const*> ||
+                       std::is_same_v<U, char*> ||
+                       std::is_same_v<U, std::string> ||
+                       std::is_same_v<U, std::string_view>) {
+    return LogArgType::STRING;
+  } else if constexpr (std::is_same_v<U, void const*> ||
+                       std::is_same_v<U, void*> ||
+                       std::is_same_v<U, std::nullptr_t>) {
+    return LogArgType::POINTER;
+  } else {
+    return std::nullopt;
+  }
+}
+
+template <LogArgType TYPE>
+struct LogArgStorage;
+template <>
+struct LogArgStorage<LogArgType::BOOL> {
+  typedef bool type;
+};
+template <>
+struct LogArgStorage<LogArgType::CHAR> {
+  typedef char type;
+};
+template <>
+struct LogArgStorage<LogArgType::INT> {
+  typedef std::int64_t type;
+};
+template <>
+struct LogArgStorage<LogArgType::UINT> {
+  typedef std::uint64_t type;
+};
+template <>
+struct LogArgStorage<LogArgType::FLOAT> {
+  typedef float type;
+};
+template <>
+struct LogArgStorage<LogArgType::DOUBLE> {
+  typedef double type;
+};
+template <>
+struct LogArgStorage<LogArgType::STRING> {
+  typedef std::string_view type;
+};
+template <>
+struct LogArgStorage<LogArgType::POINTER> {
+  typedef void const* type;
+};
 
+template <LogArgType TYPE>
+using LogArgStorageT = typename LogArgStorage<TYPE>::type;
+
+// Reads values back in the order they were written by LogArgs::Encode
+class LogArgReader {
+ public:
+  explicit LogArgReader(std::byte const* data) : data_(data) {}
+
+  template <LogArgType TYPE>
+  LogArgStorageT<TYPE> Read() {
+    if constexpr (TYPE == LogArgType::STRING) {
+      auto const size = Read<LogArgType::UINT>();
+      std::string_view value(reinterpret_cast<char const*>(data_), size);
+      data_ += size;
+      return value;
+    } else {
+      LogArgStorageT<TYPE> value;
+      std::memcpy(&value, data_, sizeof(value));
+      data_ += sizeof(value);
+      return value;
+    }
+  }
+
+ private:
+  std::byte const* data_;
+};
+
+// Describes how to turn the encoded arguments of a log back into a message.
+// There is one static descriptor per combination of argument types
+struct FormatDescriptor {
+  void (*format)(fmt::memory_buffer& out, fmt::string_view format,
+                 std::byte const* data);
+  LogArgType const* types;
+  std::size_t count;
+};
+
+template <LogArgType... TYPES>
+void FormatLogArgs(fmt::memory_buffer& out, fmt::string_view const format,
+                   std::byte const* data) {
+  LogArgReader reader(data);
+  // Braced initialisation guarantees the values are read in order
+  std::tuple<LogArgStorageT<TYPES>...> values{reader.Read<TYPES>()...};
+  std::apply(
+      [&](auto const&... values) {
+        fmt::vformat_to(fmt::appender(out), format,
+                        fmt::make_format_args(values...));
+      },
+      values);
+}
+
+template <LogArgType... TYPES>
+struct FormatDescriptorFor {
+  static constexpr std::array<LogArgType, sizeof...(TYPES)> TYPE_LIST{
+      TYPES...};
+  static constexpr FormatDescriptor DESCRIPTOR{
+      &FormatLogArgs<TYPES...>, TYPE_LIST.data(), sizeof...(TYPES)};
+};
+
+// The raw arguments of a log along with its format string. Compile time
+// literals are only referenced, while runtime format strings are copied in
+// after the arguments. Small logs are stored inline so queueing one does not
+// allocate, while formatting is left to the sink's thread
+class LogArgs {
+ public:
+  static constexpr std::size_t INLINE_SIZE = 64;
+
+  LogArgs() = default;
+  ~LogArgs() { Free(); }
+
+  LogArgs(LogArgs const&) = delete;
+  LogArgs& operator=(LogArgs const&) = delete;
+  LogArgs(LogArgs&& other) noexcept { MoveFrom(other); }
+  LogArgs& operator=(LogArgs&& other) noexcept {
+    if (this != &other) {
+      Free();
+      MoveFrom(other);
+    }
+    return *this;
+  }
+
+  // format must outlive the log, which literals always do
+  template <class... Args>
+  void Encode(std::string_view const format, Args const&... args) {
+    EncodeWith(format, false, args...);
+  }
+
+  // For format strings that may not outlive the log (e.g. fmt::runtime)
+  template <class... Args>
+  void EncodeCopyingFormat(std::string_view const format,
+                           Args const&... args) {
+    EncodeWith(format, true, args...);
+  }
+
+  void Format(fmt::memory_buffer& out) const {
+    if (descriptor_) {
+      auto const format = FormatString();
+      descriptor_->format(out, fmt::string_view(format.data(), format.size()),
+                          Data());
+    }
+  }
+
+  FormatDescriptor const* Descriptor() const { return descriptor_; }
+  std::string_view FormatString() const {
+    if (format_.data()) {
+      return std::string_view(format_.data(), format_.size());
+    }
+    return std::string_view(reinterpret_cast<char const*>(Data()) + Size(),
+                            format_.size());
+  }
+  std::byte const* Data() const {
+    return size_ > INLINE_SIZE ? overflow_ : inline_;
+  }
+  // Just the arguments, not a copied format string
+  std::size_t Size() const {
+    return format_.data() ? size_ : size_ - format_.size();
+  }
+
+ private:
+  FormatDescriptor const* descriptor_ = nullptr;
+  // Has no data if the format string was copied in after the arguments
+  fmt::string_view format_;
+  std::size_t size_ = 0;
+  // Larger logs keep a pointer to the heap in place of the inline data
+  union {
+    std::byte inline_[INLINE_SIZE];
+    std::byte* overflow_;
+  };
+
+  std::byte* Allocate(std::size_t const size) {
+    Free();
+    size_ = size;
+    if (size_ <= INLINE_SIZE) {
+      return inline_;
+    }
+    overflow_ = new std::byte[size_];
+    return overflow_;
+  }
+
+  void Free() {
+    if (size_ > INLINE_SIZE) {
+      delete[] overflow_;
+    }
+    size_ = 0;
+  }
+
+  // Leaves other empty
+  template <class... Args>
+  void EncodeWith(std::string_view const format, bool const copyFormat,
+                  Args const&... args) {
+    if constexpr ((GetLogArgType<Args>().has_value() && ...)) {
+      descriptor_ =
+          &FormatDescriptorFor<*GetLogArgType<Args>()...>::DESCRIPTOR;
+      auto const argsSize = (std::size_t{0} + ... + EncodedSize(args));
+      auto data = Allocate(argsSize + (copyFormat ? format.size() : 0));
+      (Write(data, args), ...);
+      if (copyFormat) {
+        std::memcpy(data, format.data(), format.size());
+        format_ = fmt::string_view(nullptr, format.size());
+      } else {
+        format_ = fmt::string_view(format.data(), format.size());
+      }
+    } else {
+      Encode("{}", fmt::vformat(fmt::string_view(format.data(), format.size()),
+                                fmt::make_format_args(args...)));
+    }
+  }
+
+  void MoveFrom(LogArgs& other) {
+    descriptor_ = other.descriptor_;
+    format_ = other.format_;
+    size_ = other.size_;
+    if (size_ > INLINE_SIZE) {
+      overflow_ = other.overflow_;
+    } else {
+      std::memcpy(inline_, other.inline_, size_);
+    }
+    other.size_ = 0;
+  }
+
+  static std::string_view AsString(std::string_view const value) {
+    return value;
+  }
+  static std::string_view AsString(char const* value) {
+    return value ? std::string_view(value) : std::string_view("(null)");
+  }
+
+  template <class T>
+  static std::size_t EncodedSize(T const& value) {
+    constexpr auto TYPE = *GetLogArgType<T>();
+    if constexpr (TYPE == LogArgType::STRING) {
+      return sizeof(std::uint64_t) + AsString(value).size();
+    } else {
+      return sizeof(LogArgStorageT<TYPE>);
+    }
+  }
+
+  template <class T>
+  static void Write(std::byte*& data, T const& value) {
+    constexpr auto TYPE = *GetLogArgType<T>();
+    if constexpr (TYPE == LogArgType::STRING) {
+      auto const string = AsString(value);
+      Write(data, static_cast<std::uint64_t>(string.size()));
+      std::memcpy(data, string.data(), string.size());
+      data += string.size();
+    } else {
+      auto const stored = static_cast<LogArgStorageT<TYPE>>(value);
+      std::memcpy(data, &stored, sizeof(stored));
+      data += sizeof(stored);
+    }
+  }
+};
+
+// Append-only table handing out small integer handles for values shared by
+// many logs, such as component names and layouts. Adding takes a lock but
+// looking up a handle does not, as entries are never moved or removed
+template <class T>
+class InternTable {
+ public:
+  InternTable() = default;
+  ~InternTable() {
+    for (auto& chunk : chunks_) {
+      delete chunk.load(std::memory_order_relaxed);
+    }
+  }
+
+  InternTable(InternTable const&) = delete;
+  InternTable& operator=(InternTable const&) = delete;
+  InternTable(InternTable&&) = delete;
+  InternTable& operator=(InternTable&&) = delete;
+
+  // Returns the handle of the value created from key, creating it with
+  // create(key) if this is the first time key has been seen
+  template <class Create>
+  std::uint32_t Intern(std::string const& key, Create&& create) {
+    std::unique_lock lock(mutex_);
+    auto const existing = handles_.find(key);
+    if (existing != handles_.end()) {
+      return existing->second;
+    }
+
+    auto const handle = static_cast<std::uint32_t>(values_.size());
+    assert(handle < CHUNK_SIZE * MAX_CHUNKS && "Too many values interned");
+    values_.push_back(std::make_unique<T const>(create(key)));
+    auto& chunk = chunks_[handle / CHUNK_SIZE];
+    if (!chunk.load(std::memory_order_relaxed)) {
+      chunk.store(new Chunk{}, std::memory_order_release);
+    }
+    (*chunk.load(std::memory_order_relaxed))[handle % CHUNK_SIZE].store(
+        values_.back().get(), std::memory_order_release);
+    handles_.insert({key, handle});
+    return handle;
+  }
+
+  // The handle must have been returned by Intern
+  T const& Get(std::uint32_t const handle) const {
+    auto chunk = chunks_[handle / CHUNK_SIZE].load(std::memory_order_acquire);
+    return *(*chunk)[handle % CHUNK_SIZE].load(std::memory_order_acquire);
+  }
+
+ private:
+  static constexpr std::size_t CHUNK_SIZE = 256;
+  static constexpr std::size_t MAX_CHUNKS = 4096;
+  typedef std::array<std::atomic<T const*>, CHUNK_SIZE> Chunk;
+
+  std::array<std::atomic<Chunk*>, MAX_CHUNKS> chunks_{};
+  std::mutex mutex_;
+  std::unordered_map<std::string, std::uint32_t> handles_;
+  std::vector<std::unique_ptr<T const>> values_;
+};
+
+// Hash map from strings that can be searched without a lock while another
+// thread inserts. Nothing is ever removed and each bucket is a list that new
+// entries are pushed onto the front of, so a reader always sees a complete
+// list. Growing builds a new table and keeps the old one (readers may still be
+// in it), which costs at most about as much again as the current table
+template <class T>
+class InsertOnlyMap {
+ public:
+  InsertOnlyMap() { Grow(); }
+  ~InsertOnlyMap() = default;
+
+  InsertOnlyMap(InsertOnlyMap const&) = delete;
+  InsertOnlyMap& operator=(InsertOnlyMap const&) = delete;
+  InsertOnlyMap(InsertOnlyMap&&) = delete;
+  InsertOnlyMap& operator=(InsertOnlyMap&&) = delete;
+
+  // Lock-free. The pointer stays valid for the life of the map, or is nullptr
+  // if key has not been inserted
+  T const* Find(std::string_view const key) const {
+    auto const& table = *table_.load(std::memory_order_acquire);
+    auto const hash = std::hash<std::string_view>{}(key);
+    auto node = table.buckets[hash & (table.buckets.size() - 1)].load(
+        std::memory_order_acquire);
+    for (; node; node = node->next) {
+      if (node->hash == hash && node->key == key) {
+        return &node->value;
+      }
+    }
+    return nullptr;
+  }
+
+  // The rest must not be called concurrently with each other, only with Find
+
+  // Returns false (and does nothing) if key is already in the map
+  bool Insert(std::string const& key, T value) {
+    if (Find(key)) {
+      return false;
+    }
+    auto table = tables_.back().get();
+    if (size_ >= table->buckets.size()) {
+      table = Grow();
+    }
+    Link(*table, std::make_unique<Node>(
+                     Node{key, std::hash<std::string_view>{}(key),
+                          std::move(value), nullptr}));
+    ++size_;
+    return true;
+  }
+
+  template <class Function>
+  void ForEach(Function&& function) const {
+    for (auto const& node : tables_.back()->nodes) {
+      function(node->value);
+    }
+  }
+
+  std::size_t Size() const { return size_; }
+
+ private:
+  static constexpr std::size_t MIN_BUCKETS = 16;
+
+  struct Node {
+    std::string key;
+    std::size_t hash;
+    T value;
+    Node const* next;
+  };
+
+  struct Table {
+    explicit Table(std::size_t const size) : buckets(size) {}
+
+    std::vector<std::atomic<Node const*>> buckets;
+    std::vector<std::unique_ptr<Node>> nodes;
+  };
+
+  std::atomic<Table const*> table_;
+  std::vector<std::unique_ptr<Table>> tables_;
+  std::size_t size_ = 0;
+
+  // Copies everything into a table twice the size and publishes it
+  Table* Grow() {
+    auto next = std::make_unique<Table>(std::max(MIN_BUCKETS, 2 * size_));
+    if (!tables_.empty()) {
+      for (auto const& node : tables_.back()->nodes) {
+        Link(*next, std::make_unique<Node>(*node));
+      }
+    }
+    table_.store(next.get(), std::memory_order_release);
+    tables_.push_back(std::move(next));
+    return tables_.back().get();
+  }
+
+  static void Link(Table& table, std::unique_ptr<Node> node) {
+    auto& head = table.buckets[node->hash & (table.buckets.size() - 1)];
+    node->next = head.load(std::memory_order_relaxed);
+    head.store(node.get(), std::memory_order_release);
+    table.nodes.push_back(std::move(node));
+  }
+};
+
+inline InternTable<std::string> componentNames;
+
+typedef std::chrono::sys_time<std::chrono::nanoseconds> LogDate;
+
+// When a log was made, worked out from its ticks on the backend
+struct LogTime {
+  std::chrono::nanoseconds uptime;
+  LogDate date;
+};
+
+// Logs are timestamped with a raw tick count, which is all the logging thread
+// pays for, and only turned into a time on the backend. Ticks are the TSC
+// where it is invariant (a few cycles to read) and nanoseconds of the
+// monotonic clock otherwise
+class LogClock {
+ public:
+  static std::uint64_t Now() { return Read(epoch_.tsc); }
+
+  static LogTime Time(std::uint64_t const ticks) {
+    auto const uptime = Uptime(ticks);
+    return {uptime, epoch_.start + uptime};
+  }
+
+  // Time since the program started
+  static std::chrono::nanoseconds Uptime(std::uint64_t const ticks) {
+    if (ticks <= epoch_.ticks) {
+      // Coarse ticks can be from just before the epoch
+      return std::chrono::nanoseconds(0);
+    }
+    if (!epoch_.tsc) {
+      return std::chrono::nanoseconds(ticks - epoch_.ticks);
+    }
+    thread_local TscScale scale;
+    return scale.Uptime(ticks);
+  }
+
+  // The wall clock time at start up. Dates are this plus the uptime, so they
+  // do not jump if the system clock is changed while running
+  static LogDate Start() { return epoch_.start; }
+
+ private:
+  struct Epoch {
+    bool tsc;
+    std::uint64_t ticks;
+    std::uint64_t steady;
+    LogDate start;
+  };
+
+  // TSC ticks to nanoseconds, measured against the monotonic clock over the
+  // whole run so far. Each backend thread keeps its own so it needs no lock.
+  // It is remeasured once the run has doubled in length (or a second has
+  // passed), so the error stays around that of a single clock reading
+  class TscScale {
+   public:
+    std::chrono::nanoseconds Uptime(std::uint64_t const ticks) {
+      if (ticks >= nextUpdate_) {
+        Update();
+      }
+      return std::chrono::nanoseconds(static_cast<std::int64_t>(
+          static_cast<double>(ticks - epoch_.ticks) * nsPerTick_));
+    }
+
+   private:
+    static constexpr std::uint64_t MAX_UPDATE_INTERVAL = 1'000'000'000;
+
+    double nsPerTick_ = 0.0;
+    std::uint64_t nextUpdate_ = 0;
+
+    void Update() {
+      auto const steady = SteadyNow() - epoch_.steady;
+      auto const ticks = Read(true) - epoch_.ticks;
+      if (ticks == 0) {
+        return;
+      }
+      nsPerTick_ = static_cast<double>(steady) / static_cast<double>(ticks);
+      auto const interval = std::min(ticks, static_cast<std::uint64_t>(
+                                                MAX_UPDATE_INTERVAL /
+                                                std::max(nsPerTick_, 1e-3)));
+      nextUpdate_ = epoch_.ticks + ticks + std::max<std::uint64_t>(interval, 1);
+    }
+  };
+
+  static std::uint64_t Read([[maybe_unused]] bool const tsc) {
+#if ASYNC_LIB_HAS_TSC
+    if (tsc) {
+      return __rdtsc();
+    }
+#endif
+#if defined(LOG_COARSE_CLOCK) && defined(__linux__)
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+    return static_cast<std::uint64_t>(now.tv_sec) * 1'000'000'000 +
+           static_cast<std::uint64_t>(now.tv_nsec);
+#else
+    return SteadyNow();
+#endif
+  }
+
+  static std::uint64_t SteadyNow() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  // Bit 8 of EDX in leaf 0x80000007 says the TSC ticks at a constant rate
+  // whatever the power state, and so can be used as a clock
+  static bool HasInvariantTsc() {
+#if ASYNC_LIB_HAS_TSC && !defined(LOG_COARSE_CLOCK)
+    unsigned eax, ebx, ecx, edx;
+    return __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) &&
+           (edx & (1u << 8));
+#else
+    return false;
+#endif
+  }
+
+  static Epoch MakeEpoch() {
+    Epoch epoch{HasInvariantTsc(), 0, SteadyNow(), {}};
+    epoch.ticks = Read(epoch.tsc);
+    epoch.start = std::chrono::time_point_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now());
+    return epoch;
+  }
+
+  inline static Epoch const epoch_ = MakeEpoch();
+};
+
+// Small ids given to threads the first time they log, for {thread}
+inline std::atomic_uint32_t nextLogThreadId{1};
+
+inline std::uint32_t LogThreadId() {
+  thread_local std::uint32_t id = 0;
+  if (id == 0) {
+    id = nextLogThreadId.fetch_add(1, std::memory_order_relaxed);
+  }
+  return id;
+}
+
+// Everything but the arguments is a handle or plain value so queueing a log
+// never allocates and a record fits in two cache lines
 struct Log {
-  std::string message;
+  LogArgs args;
+  // Raw LogClock ticks
+  std::uint64_t time;
+  // Counts the logs of each logger, wrapping after 2^32
+  std::uint32_t seq;
+  std::uint32_t component;
+  std::uint32_t layout;
+  std::uint32_t thread;
+  LogLevel level;
+  // The sinks the log goes to, see sinkTargets
+  std::uint32_t targets = 0;
+};
+
+static_assert(sizeof(Log) <= 2 * CACHE_LINE_SIZE);
+
+// A log format (e.g. "[{time:08f}] {message}") parsed up front into a list of
+// literal text and fields, so nothing needs parsing for each log
+class LogLayout {
+ public:
+  explicit LogLayout(std::string_view const pattern) : pattern_(pattern) {
+    Parse(pattern);
+  }
+
+  std::string const& Pattern() const { return pattern_; }
+
+  void Format(fmt::memory_buffer& out, Log const& log, LogTime const& time,
+              std::string_view const message) const {
+    for (auto const& segment : segments_) {
+      switch (segment.field) {
+        case Field::TEXT:
+          out.append(segment.text);
+          break;
+        case Field::TIME:
+          FormatField(out, segment,
+                      std::chrono::duration<double>(time.uptime).count());
+          break;
+        case Field::DATE:
+          if (segment.text.empty()) {
+            FormatDate(out, time.date);
+          } else {
+            FormatField(out, segment, ToTm(time.date));
+          }
+          break;
+        case Field::THREAD:
+          FormatField(out, segment, log.thread);
+          break;
+        case Field::SEQ:
+          FormatField(out, segment, log.seq);
+          break;
+        case Field::COMPONENT:
+          FormatField(out, segment,
+                      std::string_view(componentNames.Get(log.component)));
+          break;
+        case Field::LEVEL:
+          FormatField(out, segment, std::string_view(LogLevelName[log.level]));
+          break;
+        case Field::MESSAGE:
+          FormatField(out, segment, message);
+          break;
+      }
+    }
+  }
+
+ private:
+  enum class Field {
+    TEXT,
+    TIME,
+    DATE,
+    THREAD,
+    SEQ,
+    COMPONENT,
+    LEVEL,
+    MESSAGE
+  };
+
+  struct Segment {
+    Field field;
+    // The literal text, or the field's format (e.g. "{:08f}") if it has a spec
+    std::string text;
+  };
+
+  std::string pattern_;
+  std::vector<Segment> segments_;
+
+  template <class T>
+  static void FormatField(fmt::memory_buffer& out, Segment const& segment,
+                          T const& value) {
+    if (segment.text.empty()) {
+      if constexpr (std::is_same_v<T, std::string_view>) {
+        out.append(value);
+      } else {
+        fmt::format_to(fmt::appender(out), "{}", value);
+      }
+    } else {
+      fmt::vformat_to(fmt::appender(out), segment.text,
+                      fmt::make_format_args(value));
+    }
+  }
+
+  // ISO 8601 in UTC with nanoseconds, e.g. 2024-01-31T12:00:00.000000001Z
+  static void FormatDate(fmt::memory_buffer& out, LogDate const date) {
+    auto const days = std::chrono::floor<std::chrono::days>(date);
+    std::chrono::year_month_day const ymd(days);
+    std::chrono::hh_mm_ss const time(date - days);
+    fmt::format_to(fmt::appender(out),
+                   "{:04}-{:02}-{:02}T{:02}:{:02}:{:02}.{:09}Z",
+                   static_cast<int>(ymd.year()),
+                   static_cast<unsigned>(ymd.month()),
+                   static_cast<unsigned>(ymd.day()), time.hours().count(),
+                   time.minutes().count(), time.seconds().count(),
+                   time.subseconds().count());
+  }
+
+  // For dates with a strftime style spec (e.g. {date:%H:%M:%S})
+  static std::tm ToTm(LogDate const date) {
+    auto const days = std::chrono::floor<std::chrono::days>(date);
+    std::chrono::year_month_day const ymd(days);
+    std::chrono::hh_mm_ss const time(
+        std::chrono::floor<std::chrono::seconds>(date - days));
+    std::tm tm{};
+    tm.tm_year = static_cast<int>(ymd.year()) - 1900;
+    tm.tm_mon = static_cast<int>(static_cast<unsigned>(ymd.month())) - 1;
+    tm.tm_mday = static_cast<int>(static_cast<unsigned>(ymd.day()));
+    tm.tm_hour = static_cast<int>(time.hours().count());
+    tm.tm_min = static_cast<int>(time.minutes().count());
+    tm.tm_sec = static_cast<int>(time.seconds().count());
+    tm.tm_wday = static_cast<int>(std::chrono::weekday(days).c_encoding());
+    tm.tm_yday = static_cast<int>(
+        (days - std::chrono::sys_days(ymd.year() / 1 / 1)).count());
+    return tm;
+  }
+
+  void Parse(std::string_view pattern) {
+    std::string text;
+    while (!pattern.empty()) {
+      auto const brace = pattern.find_first_of("{}");
+      text += pattern.substr(0, brace);
+      if (brace == std::string_view::npos) {
+        break;
+      }
+      // Escaped braces
+      if (brace + 1 < pattern.size() && pattern[brace + 1] == pattern[brace]) {
+        text += pattern[brace];
+        pattern.remove_prefix(brace + 2);
+        continue;
+      }
+      auto const end = pattern.find('}', brace);
+      if (pattern[brace] == '}' || end == std::string_view::npos) {
+        // Unmatched brace so keep it as text
+        text += pattern.substr(brace, 1);
+        pattern.remove_prefix(brace + 1);
+        continue;
+      }
+
+      auto const replacement = pattern.substr(brace + 1, end - brace - 1);
+      auto const colon = replacement.find(':');
+      auto const field = ParseField(replacement.substr(0, colon));
+      if (!field) {
+        // Unknown fields are output as they are
+        text += pattern.substr(brace, end - brace + 1);
+      } else {
+        AddText(text);
+        std::string spec;
+        if (colon != std::string_view::npos) {
+          spec = fmt::format("{{{}}}", replacement.substr(colon));
+        }
+        segments_.push_back({*field, ValidSpec(*field, spec)});
+      }
+      pattern.remove_prefix(end + 1);
+    }
+    AddText(text);
+  }
+
+  void AddText(std::string& text) {
+    if (!text.empty()) {
+      segments_.push_back({Field::TEXT, std::move(text)});
+      text.clear();
+    }
+  }
+
+  static std::optional<Field> ParseField(std::string_view const name) {
+    if (name == "time") {
+      return Field::TIME;
+    } else if (name == "date") {
+      return Field::DATE;
+    } else if (name == "thread") {
+      return Field::THREAD;
+    } else if (name == "seq") {
+      return Field::SEQ;
+    } else if (name == "component") {
+      return Field::COMPONENT;
+    } else if (name == "level") {
+      return Field::LEVEL;
+    } else if (name == "message") {
+      return Field::MESSAGE;
+    }
+    return std::nullopt;
+  }
+
+  // Checks the spec now so a bad one cannot throw on the sink's thread. Bad
+  // specs are dropped
+  static std::string ValidSpec(Field const field, std::string spec) {
+    if (spec.empty()) {
+      return spec;
+    }
+    try {
+      fmt::memory_buffer out;
+      Segment const segment{field, spec};
+      if (field == Field::TIME) {
+        FormatField(out, segment, 0.0);
+      } else if (field == Field::DATE) {
+        FormatField(out, segment, ToTm(LogDate()));
+      } else if (field == Field::THREAD || field == Field::SEQ) {
+        FormatField(out, segment, std::uint32_t{0});
+      } else {
+        FormatField(out, segment, std::string_view());
+      }
+    } catch (fmt::format_error const&) {
+      spec.clear();
+    }
+    return spec;
+  }
+};
+
+// Keyed by the layout's pattern so loggers with the same layout share it
+inline InternTable<LogLayout> logLayouts;
+
+// A bad format string can only be found now that formatting is deferred, so
+// report it in the log rather than take down the sink's thread
+inline void FormatMessage(Log const& log, fmt::memory_buffer& message) {
+  try {
+    log.args.Format(message);
+  } catch (fmt::format_error const& error) {
+    message.clear();
+    fmt::format_to(fmt::appender(message), "[format error: {}]", error.what());
+  }
+}
+
+// Formats the whole line for log using its layout
+inline void FormatLog(Log const& log, fmt::memory_buffer& line) {
+  fmt::memory_buffer message;
+  FormatMessage(log, message);
+  logLayouts.Get(log.layout)
+      .Format(line, log, LogClock::Time(log.time),
+              std::string_view(message.data(), message.size()));
+}
+
+}  // namespace internal
+
+// Where logs end up. Write, Idle and Tick are called from the logger's backend
+// threads and Flush from any thread, so sinks must be thread safe
+class Sink {
+ public:
+  virtual ~Sink() = default;
+
+  // line is the formatted log without a trailing newline, or empty if the
+  // sink does not need formatting
+  virtual void Write(internal::Log const& log, std::string_view line) = 0;
+  // Sinks that store the raw log (e.g. BinarySink) save it being formatted
+  virtual bool NeedsFormatting() const { return true; }
+  // Called when the worker thread has no more logs to write for now
+  virtual void Idle() { Flush(); }
+  // Called regularly while the backend is busy, even if this sink is not
+  virtual void Tick() {}
+  virtual void Flush() {}
+};
+
+class OStreamSink : public Sink {
+ public:
+  explicit OStreamSink(std::shared_ptr<std::ostream> const& stream)
+      : stream_(stream) {}
+
+  void Write(internal::Log const&, std::string_view const line) override {
+    std::unique_lock lock(mutex_);
+    stream_->write(line.data(), line.size()).put('\n');
+  }
+
+  void Flush() override {
+    std::unique_lock lock(mutex_);
+    stream_->flush();
+  }
+
+ private:
+  std::shared_ptr<std::ostream> stream_;
+  std::mutex mutex_;
+};
+
+// When a FileSink writes out what it has buffered
+struct FlushPolicy {
+  // Write once this many bytes are buffered
+  std::size_t bufferSize = 64 * 1024;
+  // The longest a log stays buffered while the backend is busy, give or take
+  // its tick interval. Whenever it runs out of logs everything buffered is
+  // written anyway
+  std::chrono::milliseconds interval{100};
+  // Logs this severe or worse are written straight away
+  internal::LogLevel flushLevel = internal::LogLevel::ERROR;
+};
+
+// Writes logs to a file, collecting them in a buffer so a whole batch goes
+// out in a single write rather than a flush per line
+class FileSink : public Sink {
+ public:
+  explicit FileSink(std::string const& path, FlushPolicy const& policy = {})
+      : policy_(policy), file_(std::fopen(path.c_str(), "wb")) {
+    if (file_) {
+      // We do our own buffering
+      std::setvbuf(file_, nullptr, _IONBF, 0);
+    }
+    buffer_.reserve(policy_.bufferSize);
+  }
+
+  ~FileSink() override {
+    Flush();
+    if (file_) {
+      std::fclose(file_);
+    }
+  }
+
+  FileSink(FileSink const&) = delete;
+  FileSink& operator=(FileSink const&) = delete;
+  FileSink(FileSink&&) = delete;
+  FileSink& operator=(FileSink&&) = delete;
+
+  void Write(internal::Log const& log, std::string_view const line) override {
+    Buffer(log.level, [&](std::string& buffer) {
+      buffer.append(line);
+      buffer.push_back('\n');
+    });
+  }
+
+  void Flush() override {
+    std::unique_lock lock(mutex_);
+    WriteBuffer();
+  }
+
+  // Catches a buffer that has waited too long when no more logs come in for
+  // this sink to check it on
+  void Tick() override {
+    auto const now = std::chrono::steady_clock::now();
+    std::unique_lock lock(mutex_);
+    if (!buffer_.empty() && now - oldest_ >= policy_.interval) {
+      WriteBuffer();
+    }
+  }
+
+  // Logs are dropped if the file could not be opened
+  bool IsOpen() const { return file_ != nullptr; }
+
+ protected:
+  // Adds to the buffer with append(buffer), then writes the buffer out if the
+  // flush policy says to. append is called while holding a lock
+  template <class Append>
+  void Buffer(internal::LogLevel const level, Append&& append) {
+    auto const now = std::chrono::steady_clock::now();
+    std::unique_lock lock(mutex_);
+    if (buffer_.empty()) {
+      oldest_ = now;
+    }
+    append(buffer_);
+    if (buffer_.size() >= policy_.bufferSize || level <= policy_.flushLevel ||
+        now - oldest_ >= policy_.interval) {
+      WriteBuffer();
+    }
+  }
+
+ private:
+  FlushPolicy policy_;
+  std::FILE* file_;
+  std::string buffer_;
+  std::chrono::steady_clock::time_point oldest_;
+  std::mutex mutex_;
+
+  // Must hold mutex_
+  void WriteBuffer() {
+    if (file_ && !buffer_.empty()) {
+      std::fwrite(buffer_.data(), 1, buffer_.size(), file_);
+    }
+    buffer_.clear();
+  }
+};
+
+#ifdef __linux__
+
+// When a MappedFileSink moves on to a new file
+struct RotationPolicy {
+  // The space mapped for each file. Rotates once the next log would not fit
+  std::size_t maxFileSize = 64 * 1024 * 1024;
+  // Also rotate once a file has been open this long
+  std::optional<std::chrono::seconds> maxFileAge{};
+  // How many old files to keep as path.1 (newest) to path.maxFiles (oldest)
+  std::size_t maxFiles = 5;
+};
+
+// Writes logs straight into a preallocated, memory mapped file so each log is
+// a copy into the page cache with no system call. Once the file is full (or
+// old enough) it is trimmed to what was written and renamed to path.1, older
+// files are shifted along and a new file is started at path
+class MappedFileSink : public Sink {
+ public:
+  explicit MappedFileSink(std::string const& path,
+                          RotationPolicy const& policy = {})
+      : path_(path), policy_(policy) {
+    Open();
+  }
+
+  ~MappedFileSink() override { Close(); }
+
+  MappedFileSink(MappedFileSink const&) = delete;
+  MappedFileSink& operator=(MappedFileSink const&) = delete;
+  MappedFileSink(MappedFileSink&&) = delete;
+  MappedFileSink& operator=(MappedFileSink&&) = delete;
+
+  void Write(internal::Log const&, std::string_view line) override {
+    std::unique_lock lock(mutex_);
+    auto const full = offset_ + line.size() + 1 > policy_.maxFileSize;
+    auto const expired =
+        policy_.maxFileAge &&
+        std::chrono::steady_clock::now() - opened_ >= *policy_.maxFileAge;
+    if (offset_ > 0 && (full || expired)) {
+      Rotate();
+    }
+    if (!data_) {
+      return;
+    }
+    // A log bigger than a whole file is cut short
+    line = line.substr(0, std::min(line.size(), policy_.maxFileSize - 1));
+    std::memcpy(data_ + offset_, line.data(), line.size());
+    data_[offset_ + line.size()] = '\n';
+    offset_ += line.size() + 1;
+  }
+
+  // The page cache already has everything so this only starts writeback
+  void Flush() override {
+    std::unique_lock lock(mutex_);
+    if (data_) {
+      msync(data_, policy_.maxFileSize, MS_ASYNC);
+    }
+  }
+
+  // Logs are dropped if the file could not be opened and mapped
+  bool IsOpen() const { return data_ != nullptr; }
+
+ private:
+  std::string const path_;
+  RotationPolicy const policy_;
+  int file_ = -1;
+  char* data_ = nullptr;
+  std::size_t offset_ = 0;
+  std::chrono::steady_clock::time_point opened_;
+  std::mutex mutex_;
+
+  void Open() {
+    offset_ = 0;
+    opened_ = std::chrono::steady_clock::now();
+    file_ = open(path_.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (file_ < 0) {
+      return;
+    }
+    // Reserve the blocks up front so running out of disk fails here rather
+    // than with a SIGBUS when the mapping is written to
+    if (posix_fallocate(file_, 0, policy_.maxFileSize) != 0) {
+      return;
+    }
+    auto const data = mmap(nullptr, policy_.maxFileSize, PROT_WRITE,
+                           MAP_SHARED, file_, 0);
+    if (data != MAP_FAILED) {
+      data_ = static_cast<char*>(data);
+    }
+  }
+
+  // Unmaps the file and trims off the unwritten space
+  void Close() {
+    if (data_) {
+      munmap(data_, policy_.maxFileSize);
+      data_ = nullptr;
+    }
+    if (file_ >= 0) {
+      [[maybe_unused]] auto const result = ftruncate(file_, offset_);
+      close(file_);
+      file_ = -1;
+    }
+  }
+
+  void Rotate() {
+    Close();
+    if (policy_.maxFiles == 0) {
+      std::remove(path_.c_str());
+    }
+    for (auto i = policy_.maxFiles; i > 0; --i) {
+      auto const from = i == 1 ? path_ : fmt::format("{}.{}", path_, i - 1);
+      std::rename(from.c_str(), fmt::format("{}.{}", path_, i).c_str());
+    }
+    Open();
+  }
+};
+
+#endif
+
+namespace internal {
+
+class LoggerRegistry;
+
+struct SinkTarget {
+  std::shared_ptr<Sink> sink;
+  // Only logs this severe or worse are written to sink
   LogLevel level;
-  std::string component;
-  std::string format;
-  float time;
+  bool formatted;
+};
+
+// Each distinct set of sinks loggers write to, keyed by the sinks' addresses
+// and levels. Interned values are never freed so the sinks stay alive
+inline InternTable<std::vector<SinkTarget>> sinkTargets;
+
+#if FMT_VERSION >= 100000
+typedef fmt::runtime_format_string<char> RuntimeFormatString;
+#else
+typedef fmt::basic_runtime<char> RuntimeFormatString;
+#endif
+
+// The format string of a log. Literals are checked against the arguments at
+// compile time and only referenced by the log. Ones made with fmt::runtime
+// are copied into the log as they may not outlive it
+template <class... Args>
+class LogFormat {
+ public:
+  template <class S, class = std::enable_if_t<
+                         std::is_convertible_v<S const&, fmt::string_view>>>
+  consteval LogFormat(S const& format) : format_(format) {
+    // Only constructed for its compile time check
+    static_cast<void>(fmt::format_string<Args...>(format));
+  }
+  LogFormat(RuntimeFormatString const format) : format_(format.str) {
+    runtime_ = true;
+  }
+
+  std::string_view View() const {
+    return std::string_view(format_.data(), format_.size());
+  }
+  bool IsRuntime() const { return runtime_; }
+
+ private:
+  fmt::string_view format_;
+  bool runtime_ = false;
 };
 
+// Keeps Args from being deduced from the format string, as fmt does
+template <class... Args>
+using LogFormatString = LogFormat<std::type_identity_t<Args>...>;
+
+// Logs are handed to the backend through a lock-free queue so threads logging
+// at the same time never wait on a mutex
+typedef Worker<const Log, Queue<const Log, LOG_QUEUE_SIZE, queue_policy::MPMC>>
+    LogWorker;
+
 }  // namespace internal
 
+typedef internal::LogLevel LogLevel;
+
 // TODO: Add colour to logs (supported in libfmt)
 class Logger {
  public:
   Logger(std::string const& name,
-         std::shared_ptr<Worker<const internal::Log>> const& worker)
-      : name_(name), worker_(worker) {}
+         std::shared_ptr<internal::LogWorker> const& worker,
+         std::uint32_t const targets,
+         LogLevel const level = internal::DEFAULT_LOG_LEVEL)
+      : component_(internal::componentNames.Intern(
+            name, [](std::string const& name) { return name; })),
+        targets_(targets),
+        level_(level),
+        worker_(worker) {
+    SetLogFormat(DEFAULT_LOG_FORMAT);
+  }
 
   ~Logger() = default;
 
@@ -59,47 +1264,130 @@ class Logger {
 
   // TODO: Look into std::forward
 
+  // Format strings are checked against the arguments at compile time, unless
+  // made with fmt::runtime. Logs above the logger's level are dropped before
+  // anything is copied, but the arguments have already been evaluated, see
+  // LOG_INFO etc. to avoid that
   template <typename... Args>
-  void Error(char const* format, Args&&... args) {
+  void Error(internal::LogFormatString<Args...> format, Args&&... args) {
 #if LOG_LEVEL >= 2
-    SendLog(internal::LogLevel::ERROR, format, args...);
+    if (ShouldLog(LogLevel::ERROR)) {
+      SendLog(LogLevel::ERROR, format, args...);
+    }
 #endif
   }
 
   template <typename... Args>
-  void Warn(const char* format, Args&&... args) {
+  void Warn(internal::LogFormatString<Args...> format, Args&&... args) {
 #if LOG_LEVEL >= 3
-    SendLog(internal::LogLevel::WARN, format, args...);
+    if (ShouldLog(LogLevel::WARN)) {
+      SendLog(LogLevel::WARN, format, args...);
+    }
 #endif
   }
 
   template <typename... Args>
-  void Info(const char* format, Args&&... args) {
+  void Info(internal::LogFormatString<Args...> format, Args&&... args) {
 #if LOG_LEVEL >= 4
-    SendLog(internal::LogLevel::INFO, format, args...);
+    if (ShouldLog(LogLevel::INFO)) {
+      SendLog(LogLevel::INFO, format, args...);
+    }
 #endif
   }
-  void SetLogFormat(std::string format) { logFormat_ = format; }
 
- private:
-  std::string name_;
-  std::string logFormat_ = "[{time:08f}] [{component}] [{level}] {message}";
-  inline static std::chrono::time_point<timer> start_time_ = timer::now();
-  std::shared_ptr<Worker<const internal::Log>> worker_;
+  template <typename... Args>
+  void Debug(internal::LogFormatString<Args...> format, Args&&... args) {
+#if LOG_LEVEL >= 5
+    if (ShouldLog(LogLevel::DEBUG)) {
+      SendLog(LogLevel::DEBUG, format, args...);
+    }
+#endif
+  }
+
+  template <typename... Args>
+  void Trace(internal::LogFormatString<Args...> format, Args&&... args) {
+#if LOG_LEVEL >= 6
+    if (ShouldLog(LogLevel::TRACE)) {
+      SendLog(LogLevel::TRACE, format, args...);
+    }
+#endif
+  }
+
+  template <typename... Args>
+  void Log(LogLevel const level, internal::LogFormatString<Args...> format,
+           Args&&... args) {
+    if (ShouldLog(level)) {
+      SendLog(level, format, args...);
+    }
+  }
 
+  // Sends the log without checking the level, for callers that already have
   template <typename... Args>
-  void SendLog(internal::LogLevel const level, std::string const& format,
-               Args&&... args) {
-    auto time =
-        std::chrono::duration<float>(timer::now() - start_time_).count();
-    // TODO: figure out way to not use fmt::runtime
-    worker_->AddJob({fmt::format(fmt::runtime(format), args...), level, name_,
-                     logFormat_, time});
+  void LogUnchecked(LogLevel const level,
+                    internal::LogFormatString<Args...> format,
+                    Args&&... args) {
+    SendLog(level, format, args...);
+  }
+
+  // A single relaxed load, so it is cheap enough to check before building
+  // the arguments of a log
+  bool ShouldLog(LogLevel const level) const {
+    return level <= level_.load(std::memory_order_relaxed);
+  }
+
+  LogLevel Level() const { return level_.load(std::memory_order_relaxed); }
+
+  // Parsed once here rather than for every log
+  void SetLogFormat(std::string const& format) {
+    layout_ = internal::logLayouts.Intern(format, [](std::string const& format) {
+      return internal::LogLayout(format);
+    });
+  }
+
+ private:
+  static constexpr char const* DEFAULT_LOG_FORMAT =
+      "[{time:08f}] [{component}] [{level}] {message}";
+
+  friend class internal::LoggerRegistry;
+
+  std::uint32_t const component_;
+  std::atomic_uint32_t layout_{0};
+  std::atomic_uint32_t targets_;
+  // Either the global level or one set for just this logger
+  std::atomic<LogLevel> level_;
+  // Guarded by the registry's logger mutex
+  bool followsGlobalLevel_ = true;
+  std::shared_ptr<internal::LogWorker> worker_;
+  // Written by every log so kept apart from what ShouldLog reads
+  alignas(CACHE_LINE_SIZE) std::atomic_uint32_t seq_{0};
+
+  // Only copies the arguments, formatting is done on the sink's thread
+  template <typename Format, typename... Args>
+  void SendLog(LogLevel const level, Format const& format,
+               Args const&... args) {
+    internal::Log log{{},
+                      internal::LogClock::Now(),
+                      seq_.fetch_add(1, std::memory_order_relaxed),
+                      component_,
+                      layout_.load(std::memory_order_relaxed),
+                      internal::LogThreadId(),
+                      level,
+                      targets_.load(std::memory_order_relaxed)};
+    if (format.IsRuntime()) {
+      log.args.EncodeCopyingFormat(format.View(), args...);
+    } else {
+      log.args.Encode(format.View(), args...);
+    }
+    worker_->AddJob(std::move(log));
   }
 };
 
 namespace internal {
 
+// Owns the sinks and loggers. All sinks are written by a small, fixed pool of
+// backend worker threads (one by default) rather than a thread per sink. Each
+// logger sticks to one backend thread so its logs stay in order, and each log
+// is formatted once however many sinks it goes to
 class LoggerRegistry {
  public:
   LoggerRegistry() {
@@ -107,91 +1395,402 @@ class LoggerRegistry {
     CreateSink("std::cout", cout);
   }
 
-  // TODO: find out if count can crash in threaded context
-  bool LoggerExists(std::string const& name) const {
-    return loggers_.count(name) > 0;
+  // Logs still queued are written before the sinks go away. Anything logged
+  // after this (e.g. by a logger that outlives the registry) is written by
+  // the logger's last reference as it is destroyed
+  ~LoggerRegistry() {
+    for (auto& backend : backends_) {
+      backend->Stop(StopMode::DRAIN_ALL);
+    }
   }
 
+  // Only takes effect before the first logger is created. Returns false if
+  // the backend has already been started
+  bool ConfigureBackend(WorkerOptions const& options,
+                        std::size_t const threads = 1) {
+    std::unique_lock loggerLock(loggerMutex_);
+    if (!backends_.empty() || threads == 0) {
+      return false;
+    }
+    backendOptions_ = options;
+    backendThreads_ = threads;
+    return true;
+  }
+
+  bool LoggerExists(std::string_view const name) const {
+    return FindLogger(name) != nullptr;
+  }
+
+  // Does nothing if the logger already exists
   void CreateLogger(std::string const& name, std::string const& sinkName = "") {
-    auto sink = sinkName;
-    if (!SinkExists(sinkName)) {
-      sink = defaultSink_;
+    std::unique_lock loggerLock(loggerMutex_);
+    if (loggers_.Find(name)) {
+      return;
+    }
+    std::string sink;
+    {
+      std::shared_lock sinkLock(sinkMutex_);
+      sink = sinks_.contains(sinkName) ? sinkName : defaultSink_;
+    }
+    std::vector<std::pair<std::string, LogLevel>> targets{
+        {sink, LogLevel::TRACE}};
+    auto const handle = InternTargets(targets);
+    auto logger =
+        std::make_shared<Logger>(name, Backend(), handle, globalLevel_);
+    loggerTargets_.insert({name, std::move(targets)});
+    loggers_.Insert(name, std::move(logger));
+  }
+
+  // Throws std::out_of_range if the logger does not exist
+  std::shared_ptr<Logger> GetLogger(std::string_view const name) const {
+    auto const logger = loggers_.Find(name);
+    if (!logger) {
+      throw std::out_of_range("Logger does not exist");
+    }
+    return *logger;
+  }
+
+  // A lock-free hash lookup that does not touch the reference count, so is
+  // fine to call in hot loops. Loggers are never removed so the pointer is
+  // valid for the life of the registry. Returns nullptr if there is no logger
+  // called name
+  Logger* FindLogger(std::string_view const name) const {
+    auto const logger = loggers_.Find(name);
+    return logger ? logger->get() : nullptr;
+  }
+
+  // Also sends the logger's logs at least as severe as level to sink, or
+  // changes the level if it already does. Returns false if either does not
+  // exist
+  bool AddSink(std::string const& loggerName, std::string const& sinkName,
+               LogLevel const level = LogLevel::TRACE) {
+    std::unique_lock loggerLock(loggerMutex_);
+    auto const logger = loggers_.Find(loggerName);
+    if (!logger || !SinkExists(sinkName)) {
+      return false;
+    }
+    auto& targets = loggerTargets_.at(loggerName);
+    auto const existing = std::find_if(
+        targets.begin(), targets.end(),
+        [&](auto const& target) { return target.first == sinkName; });
+    if (existing != targets.end()) {
+      existing->second = level;
+    } else {
+      targets.emplace_back(sinkName, level);
     }
+    (*logger)->targets_ = InternTargets(targets);
+    return true;
+  }
+
+  // Changes the level of every logger that has not had its own level set,
+  // and the level new loggers start with
+  void SetGlobalLevel(LogLevel const level) {
     std::unique_lock loggerLock(loggerMutex_);
-    std::shared_lock sinkLock(sinkMutex_);
-    loggers_.insert({name, std::make_shared<Logger>(name, sinks_.at(sink))});
+    globalLevel_ = level;
+    loggers_.ForEach([&](std::shared_ptr<Logger> const& logger) {
+      if (logger->followsGlobalLevel_) {
+        logger->level_.store(level, std::memory_order_relaxed);
+      }
+    });
   }
 
-  std::shared_ptr<Logger> GetLogger(std::string const& name) const {
-    std::shared_lock loggerLock(loggerMutex_);
-    return loggers_.at(name);
+  // Sets the level of just one logger, or with no level goes back to using
+  // the global one. Returns false if the logger does not exist
+  bool SetLevel(std::string const& name,
+                std::optional<LogLevel> const level) {
+    std::unique_lock loggerLock(loggerMutex_);
+    auto const logger = loggers_.Find(name);
+    if (!logger) {
+      return false;
+    }
+    (*logger)->followsGlobalLevel_ = !level;
+    (*logger)->level_.store(level.value_or(globalLevel_),
+                            std::memory_order_relaxed);
+    return true;
   }
 
   bool SinkExists(std::string const& name) const {
+    std::shared_lock sinkLock(sinkMutex_);
     return sinks_.contains(name);
   }
 
-  // TODO: Add ability to have mulitple sinks for one worker
   void CreateSink(std::string const& name,
                   std::shared_ptr<std::ostream> const& stream) {
-    auto newWorker =
-        std::make_shared<Worker<const Log>>(CreateLoggerFunction(stream));
-    newWorker->StartThread();
+    CreateSink(name, std::make_shared<OStreamSink>(stream));
+  }
 
+  // Does nothing if there is already a sink called name
+  void CreateSink(std::string const& name, std::shared_ptr<Sink> const& sink) {
     std::unique_lock sinkLock(sinkMutex_);
-    sinks_.insert({name, newWorker});
+    sinks_.insert({name, sink});
   }
 
-  void SetDefaultSink(std::string name) {
-    if (SinkExists(name)) {
+  // Only opens the file if there is no sink for it yet, so two threads cannot
+  // both open (and truncate) it
+  void CreateFileSink(std::string const& path) {
+    std::unique_lock sinkLock(sinkMutex_);
+    if (!sinks_.contains(path)) {
+      sinks_.insert({path, std::make_shared<FileSink>(path)});
+    }
+  }
+
+  // Blocks until every sink has written out the logs sent so far
+  void FlushAll() {
+    {
+      std::shared_lock loggerLock(loggerMutex_);
+      for (auto& backend : backends_) {
+        backend->Flush();
+      }
+    }
+    std::shared_lock sinkLock(sinkMutex_);
+    for (auto& [name, sink] : sinks_) {
+      sink->Flush();
+    }
+  }
+
+  void SetDefaultSink(std::string const& name) {
+    std::unique_lock sinkLock(sinkMutex_);
+    if (sinks_.contains(name)) {
       defaultSink_ = name;
     }
   }
 
  private:
-  std::unordered_map<std::string, std::shared_ptr<Logger>> loggers_;
-  std::unordered_map<std::string, std::shared_ptr<Worker<const Log>>> sinks_;
+  // Read without a lock, only changed while holding loggerMutex_
+  InsertOnlyMap<std::shared_ptr<Logger>> loggers_;
+  // The sinks (and levels) each logger writes to
+  std::unordered_map<std::string, std::vector<std::pair<std::string, LogLevel>>>
+      loggerTargets_;
+  std::unordered_map<std::string, std::shared_ptr<Sink>> sinks_;
   std::string defaultSink_ = "std::cout";
+  LogLevel globalLevel_ = DEFAULT_LOG_LEVEL;
   mutable std::shared_mutex loggerMutex_;
   mutable std::shared_mutex sinkMutex_;
 
-  std::function<void(const Log&)> CreateLoggerFunction(
-      std::shared_ptr<std::ostream> const& stream) const {
-    return [=](Log const& log) {
-      // TODO: figure out way to not use fmt::runtime
-      *stream << fmt::format(fmt::runtime(log.format),
-                             fmt::arg("time", log.time),
-                             fmt::arg("component", log.component),
-                             fmt::arg("level", LogLevelName[log.level]),
-                             fmt::arg("message", log.message))
-              << std::endl;
-    };
+  WorkerOptions backendOptions_;
+  std::size_t backendThreads_ = 1;
+  std::vector<std::shared_ptr<LogWorker>> backends_;
+
+  // Must hold loggerMutex_. Loggers are spread across the backend threads in
+  // turn
+  std::shared_ptr<LogWorker> Backend() {
+    if (backends_.empty()) {
+      auto options = backendOptions_;
+      options.onIdle = [this, onIdle = std::move(options.onIdle)]() {
+        IdleSinks();
+        if (onIdle) {
+          onIdle();
+        }
+      };
+      options.onTick = [this, onTick = std::move(options.onTick)]() {
+        TickSinks();
+        if (onTick) {
+          onTick();
+        }
+      };
+      for (std::size_t i = 0; i < backendThreads_; ++i) {
+        backends_.push_back(
+            std::make_shared<LogWorker>(WriteLog, options));
+        backends_.back()->StartThread();
+      }
+    }
+    return backends_[loggers_.Size() % backends_.size()];
+  }
+
+  // Must hold loggerMutex_
+  std::uint32_t InternTargets(
+      std::vector<std::pair<std::string, LogLevel>> const& names) const {
+    std::vector<SinkTarget> targets;
+    std::string key;
+    {
+      std::shared_lock sinkLock(sinkMutex_);
+      for (auto const& [name, level] : names) {
+        auto const& sink = sinks_.at(name);
+        targets.push_back({sink, level, sink->NeedsFormatting()});
+        fmt::format_to(std::back_inserter(key), "{}:{};",
+                       static_cast<void const*>(sink.get()),
+                       static_cast<int>(level));
+      }
+    }
+    return sinkTargets.Intern(
+        key, [&](std::string const&) { return std::move(targets); });
+  }
+
+  void IdleSinks() const {
+    std::shared_lock sinkLock(sinkMutex_);
+    for (auto& [name, sink] : sinks_) {
+      sink->Idle();
+    }
+  }
+
+  void TickSinks() const {
+    std::shared_lock sinkLock(sinkMutex_);
+    for (auto& [name, sink] : sinks_) {
+      sink->Tick();
+    }
+  }
+
+  // The line is only formatted once, and only if a sink wants it
+  static void WriteLog(Log const& log) {
+    fmt::memory_buffer line;
+    auto formatted = false;
+    for (auto const& target : sinkTargets.Get(log.targets)) {
+      if (log.level > target.level) {
+        continue;
+      }
+      if (!target.formatted) {
+        target.sink->Write(log, {});
+        continue;
+      }
+      if (!formatted) {
+        FormatLog(log, line);
+        formatted = true;
+      }
+      target.sink->Write(log, std::string_view(line.data(), line.size()));
+    }
   }
 };
 
-inline static LoggerRegistry loggerRegistry{};
+inline LoggerRegistry loggerRegistry{};
 
 }  // namespace internal
 
 // TODO: Get and Set default logger that will be stored in static
 // TODO: implement Error, Warn and Info that use the default logger
 
-std::shared_ptr<Logger> GetLogger(std::string const& name = "Global",
-                                  std::string const& filePath = "") {
+inline std::shared_ptr<Logger> GetLogger(std::string const& name = "Global",
+                                         std::string const& filePath = "") {
   if (!internal::loggerRegistry.LoggerExists(name)) {
-    if (filePath != "" && !internal::loggerRegistry.SinkExists(filePath)) {
-      auto fileHandle = std::make_shared<std::ofstream>(filePath);
-      internal::loggerRegistry.CreateSink(filePath, fileHandle);
+    if (filePath != "") {
+      internal::loggerRegistry.CreateFileSink(filePath);
     }
     internal::loggerRegistry.CreateLogger(name, filePath);
   }
   return internal::loggerRegistry.GetLogger(name);
 }
 
-void SetDefaultSink(std::string const& name) {
+// Like GetLogger but returns a reference that stays valid for the rest of the
+// program, and once the logger exists costs just a lock-free hash lookup with
+// no reference counting. Cheap enough to call in a hot loop, but better still
+// is to look it up once and keep it, e.g.
+//   static auto& logger = async_lib::GetLoggerRef("Physics");
+inline Logger& GetLoggerRef(std::string_view const name = "Global",
+                            std::string const& filePath = "") {
+  if (auto logger = internal::loggerRegistry.FindLogger(name)) {
+    return *logger;
+  }
+  return *GetLogger(std::string(name), filePath);
+}
+
+// Sets up the backend threads that write to the sinks, e.g. pinning them
+// away from latency sensitive cores. Must be called before the first logger
+// is created, otherwise it returns false and does nothing
+inline bool ConfigureBackend(WorkerOptions const& options,
+                             std::size_t const threads = 1) {
+  return internal::loggerRegistry.ConfigureBackend(options, threads);
+}
+
+inline void CreateSink(std::string const& name,
+                       std::shared_ptr<std::ostream> const& stream) {
+  if (!internal::loggerRegistry.SinkExists(name)) {
+    internal::loggerRegistry.CreateSink(name, stream);
+  }
+}
+
+// Creates a sink writing through a custom Sink such as a FileSink
+inline void CreateSink(std::string const& name,
+                       std::shared_ptr<Sink> const& sink) {
+  if (!internal::loggerRegistry.SinkExists(name)) {
+    internal::loggerRegistry.CreateSink(name, sink);
+  }
+}
+
+// Also sends logger's logs at least as severe as level to sink. Both must
+// already exist
+inline bool AddSink(std::string const& logger, std::string const& sink,
+                    LogLevel const level = LogLevel::TRACE) {
+  return internal::loggerRegistry.AddSink(logger, sink, level);
+}
+
+// Blocks until everything logged so far has been written, e.g. from a crash
+// handler before exiting
+inline void FlushAll() { internal::loggerRegistry.FlushAll(); }
+
+// Sets the level of every logger that has not had its own level set
+inline void SetGlobalLogLevel(LogLevel const level) {
+  internal::loggerRegistry.SetGlobalLevel(level);
+}
+
+// Sets the level of one logger, e.g. to turn on debug logs for a single
+// component. With no level it goes back to the global level
+inline bool SetLogLevel(std::string const& logger,
+                        std::optional<LogLevel> const level) {
+  return internal::loggerRegistry.SetLevel(logger, level);
+}
+
+inline void SetDefaultSink(std::string const& name) {
   internal::loggerRegistry.SetDefaultSink(name);
 }
 
+namespace internal {
+
+// Lets the LOG_* macros take a Logger reference as well as a pointer
+inline Logger& LoggerFrom(Logger& logger) { return logger; }
+
+template <class Pointer>
+Logger& LoggerFrom(Pointer const& logger) {
+  return *logger;
+}
+
+}  // namespace internal
+
 }  // namespace async_lib
 
+// Only evaluates the arguments if logger (a Logger reference or pointer) will
+// send the log
+#define ASYNC_LIB_LOG(logger, level, ...)                      \
+  do {                                                         \
+    auto&& asyncLibLoggerHolder = (logger);                    \
+    auto& asyncLibLogger =                                     \
+        async_lib::internal::LoggerFrom(asyncLibLoggerHolder); \
+    if (asyncLibLogger.ShouldLog(level)) {                     \
+      asyncLibLogger.LogUnchecked(level, __VA_ARGS__);         \
+    }                                                          \
+  } while (false)
+
+#if LOG_LEVEL >= 2
+#define LOG_ERROR(logger, ...) \
+  ASYNC_LIB_LOG(logger, async_lib::LogLevel::ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(logger, ...) static_cast<void>(0)
+#endif
+
+#if LOG_LEVEL >= 3
+#define LOG_WARN(logger, ...) \
+  ASYNC_LIB_LOG(logger, async_lib::LogLevel::WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(logger, ...) static_cast<void>(0)
+#endif
+
+#if LOG_LEVEL >= 4
+#define LOG_INFO(logger, ...) \
+  ASYNC_LIB_LOG(logger, async_lib::LogLevel::INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(logger, ...) static_cast<void>(0)
+#endif
+
+#if LOG_LEVEL >= 5
+#define LOG_DEBUG(logger, ...) \
+  ASYNC_LIB_LOG(logger, async_lib::LogLevel::DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(logger, ...) static_cast<void>(0)
+#endif
+
+#if LOG_LEVEL >= 6
+#define LOG_TRACE(logger, ...) \
+  ASYNC_LIB_LOG(logger, async_lib::LogLevel::TRACE, __VA_ARGS__)
+#else
+#define LOG_TRACE(logger, ...) static_cast<void>(0)
+#endif
+
 #endif  // ASYNC_LIB_LOGGER_HPP
@@ -1,26 +1,97 @@
 #ifndef ASYNC_LIB_QUEUE_HPP
 #define ASYNC_LIB_QUEUE_HPP
 
-#include <atomic>
-
-#ifndef NDEBUG
 #include <assert.h>
-#endif
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <span>
+#include <thread>
+#include <utility>
 
 namespace async_lib {
 
 constexpr std::size_t DEFAULT_QUEUE_SIZE = 20;
 
-// Allows us to differentiate between empty and full queue
-constexpr std::size_t REAL_SIZE(std::size_t size) { return size + 1; }
+// Storage is rounded up to a power of two so the free-running 64-bit indices
+// can be mapped into the buffer with a mask rather than a division
+constexpr std::size_t BUFFER_SIZE(std::size_t size) {
+  return std::bit_ceil(size);
+}
+
+// std::hardware_destructive_interference_size would be the natural choice but
+// GCC warns that it is not ABI stable when used in headers
+#ifndef ASYNC_LIB_CACHE_LINE_SIZE
+#define ASYNC_LIB_CACHE_LINE_SIZE 64
+#endif
+constexpr std::size_t CACHE_LINE_SIZE = ASYNC_LIB_CACHE_LINE_SIZE;
+
+// Selects the synchronisation strategy used by a Queue
+namespace queue_policy {
+// Only safe for a single producer and a single consumer
+struct Basic {};
+// Single producer and single consumer with minimal cache line sharing
+struct SPSC {};
+// Lock-free for any number of producers and consumers
+struct MPMC {};
+// Grows as needed in segments of SIZE elements. Safe for any number of
+// producers and consumers
+struct Unbounded {};
+}  // namespace queue_policy
+
+namespace internal {
+
+// Uninitialised storage for a single element. The queues construct and
+// destroy elements explicitly so the stored type does not need a default
+// constructor and nothing is constructed until it is pushed
+template <class T>
+class Slot {
+ public:
+  template <class... Args>
+  void Construct(Args&&... args) {
+    std::construct_at(Get(), std::forward<Args>(args)...);
+  }
+
+  void Destroy() { std::destroy_at(Get()); }
+
+  // Moves the element out of the slot and destroys what is left behind
+  T Take() {
+    T data = std::move(*Get());
+    Destroy();
+    return data;
+  }
+
+  T* Get() { return std::launder(reinterpret_cast<T*>(storage_)); }
+  T const* Get() const {
+    return std::launder(reinterpret_cast<T const*>(storage_));
+  }
+
+ private:
+  alignas(T) std::byte storage_[sizeof(T)];
+};
+
+}  // namespace internal
 
-template <class T, const std::size_t SIZE = DEFAULT_QUEUE_SIZE>
+template <class T, const std::size_t SIZE = DEFAULT_QUEUE_SIZE,
+          class Policy = queue_policy::Basic>
 class Queue {
   typedef typename std::remove_const<T>::type StorageT;
 
  public:
   Queue() = default;
-  ~Queue() = default;
+  ~Queue() {
+    while (front_ != back_) {
+      data_[front_++ & MASK].Destroy();
+    }
+  }
 
   // TODO: implement these
   Queue(const Queue&) = delete;
@@ -28,32 +99,638 @@ class Queue {
   Queue(Queue&&) = delete;
   Queue& operator=(Queue&&) = delete;
 
-  T& Front() const { return data_[front_]; }
+  T& Front() const { return *data_[front_ & MASK].Get(); }
 
-  void Push(T&& data) {
+  template <class... Args>
+  void Emplace(Args&&... args) {
     assert(Size() < SIZE);
-    data_[back_++ % REAL_SIZE(SIZE)] = std::move(data);
+    auto const back = backClaim_.fetch_add(1, std::memory_order_relaxed);
+    data_[back & MASK].Construct(std::forward<Args>(args)...);
+    Publish(back_, back, 1);
   }
 
-  void Push(const T& data) {
-    assert(Size() < SIZE);
-    data_[back_++ % REAL_SIZE(SIZE)] = data;
-  }
+  void Push(StorageT&& data) { Emplace(std::move(data)); }
+  void Push(const StorageT& data) { Emplace(data); }
 
-  T Pop() {
+  StorageT Pop() {
     assert(Size() > 0);
-    return data_[front_++ % REAL_SIZE(SIZE)];
+    auto const front = frontClaim_.fetch_add(1, std::memory_order_relaxed);
+    auto data = data_[front & MASK].Take();
+    Publish(front_, front, 1);
+    return data;
+  }
+
+  // Moves as many elements from data as fit and returns how many were pushed.
+  // The index is only moved on once they are all in place, so the consumer
+  // never sees a slot that is not ready
+  std::size_t PushBulk(std::span<StorageT> data) {
+    auto const count = std::min(data.size(), SIZE - Size());
+    auto const back = backClaim_.fetch_add(count, std::memory_order_relaxed);
+    for (std::size_t i = 0; i < count; ++i) {
+      data_[(back + i) & MASK].Construct(std::move(data[i]));
+    }
+    Publish(back_, back, count);
+    return count;
+  }
+
+  // Moves up to data.size() elements into data and returns how many were
+  // popped. As with PushBulk the slots are only handed back once emptied
+  std::size_t PopBulk(std::span<StorageT> data) {
+    auto const count = std::min(data.size(), Size());
+    auto const front = frontClaim_.fetch_add(count, std::memory_order_relaxed);
+    for (std::size_t i = 0; i < count; ++i) {
+      data[i] = data_[(front + i) & MASK].Take();
+    }
+    Publish(front_, front, count);
+    return count;
+  }
+
+  // Calls function on every element currently in the queue, removing them
+  template <class Function>
+  std::size_t ConsumeAll(Function&& function) {
+    auto const count = Size();
+    auto const front = frontClaim_.fetch_add(count, std::memory_order_relaxed);
+    for (std::size_t i = 0; i < count; ++i) {
+      auto& slot = data_[(front + i) & MASK];
+      function(*slot.Get());
+      slot.Destroy();
+    }
+    Publish(front_, front, count);
+    return count;
+  }
+
+  std::size_t Size() const {
+    // front must be read first so it can never be ahead of back
+    auto const front = front_.load(std::memory_order_acquire);
+    return back_.load(std::memory_order_acquire) - front;
+  }
+  constexpr std::size_t Capacity() const { return SIZE; }
+
+ private:
+  static constexpr std::uint64_t MASK = BUFFER_SIZE(SIZE) - 1;
+
+  // Slots are claimed through the claim counters so that pushes (or pops)
+  // from several threads never share a slot, but front_ and back_, which the
+  // other side reads, are only moved on once the slots are ready. Claims are
+  // published in order, so a later one waits for those before it
+  static void Publish(std::atomic_uint64_t& index, std::uint64_t claimed,
+                      std::size_t count) {
+    while (index.load(std::memory_order_relaxed) != claimed) {
+      std::this_thread::yield();
+    }
+    index.store(claimed + count, std::memory_order_release);
+  }
+
+  mutable internal::Slot<StorageT> data_[BUFFER_SIZE(SIZE)];
+  std::atomic_uint64_t front_{0};
+  std::atomic_uint64_t back_{0};
+  std::atomic_uint64_t frontClaim_{0};
+  std::atomic_uint64_t backClaim_{0};
+};
+
+// Bounded multi-producer/multi-consumer queue based on Dmitry Vyukov's design.
+// Each slot carries a sequence number that tells producers and consumers
+// whether it is free to write or ready to read, so a position only has to be
+// claimed with a single CAS and no locks are needed
+template <class T, const std::size_t SIZE>
+class Queue<T, SIZE, queue_policy::MPMC> {
+  typedef typename std::remove_const<T>::type StorageT;
+
+ public:
+  Queue() {
+    for (std::size_t i = 0; i < BUFFER_SIZE(SIZE); ++i) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+  ~Queue() {
+    for (auto pos = front_.load(); pos != back_.load(); ++pos) {
+      cells_[pos & MASK].data.Destroy();
+    }
+  }
+
+  Queue(const Queue&) = delete;
+  Queue& operator=(const Queue&) = delete;
+  Queue(Queue&&) = delete;
+  Queue& operator=(Queue&&) = delete;
+
+  // Returns false if the queue is full
+  template <class... Args>
+  bool TryEmplace(Args&&... args) {
+    auto const [pos, count] = Claim(back_, 0, 1);
+    if (count == 0) {
+      return false;
+    }
+    auto& cell = cells_[pos & MASK];
+    cell.data.Construct(std::forward<Args>(args)...);
+    cell.sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool TryPush(StorageT&& data) { return TryEmplace(std::move(data)); }
+  bool TryPush(const StorageT& data) { return TryEmplace(data); }
+
+  // Returns an empty optional if the queue is empty
+  std::optional<StorageT> TryPop() {
+    auto const [pos, count] = Claim(front_, 1, 1);
+    if (count == 0) {
+      return std::nullopt;
+    }
+    auto& cell = cells_[pos & MASK];
+    std::optional<StorageT> data{cell.data.Take()};
+    Release(cell, pos);
+    return data;
+  }
+
+  // Returns false if the queue is empty, otherwise moves front into data
+  bool TryPop(StorageT& data) {
+    auto popped = TryPop();
+    if (popped) {
+      data = std::move(*popped);
+    }
+    return popped.has_value();
+  }
+
+  template <class... Args>
+  void Emplace(Args&&... args) {
+    [[maybe_unused]] auto const pushed =
+        TryEmplace(std::forward<Args>(args)...);
+    assert(pushed);
+  }
+
+  void Push(StorageT&& data) { Emplace(std::move(data)); }
+  void Push(const StorageT& data) { Emplace(data); }
+
+  StorageT Pop() {
+    auto data = TryPop();
+    assert(data);
+    return std::move(*data);
+  }
+
+  // Moves as many elements from data as fit and returns how many were pushed.
+  // The free slots are claimed with a single update of the back index
+  std::size_t PushBulk(std::span<StorageT> data) {
+    auto const [pos, count] = Claim(back_, 0, data.size());
+    for (std::size_t i = 0; i < count; ++i) {
+      auto& cell = cells_[(pos + i) & MASK];
+      cell.data.Construct(std::move(data[i]));
+      cell.sequence.store(pos + i + 1, std::memory_order_release);
+    }
+    return count;
+  }
+
+  // Moves up to data.size() elements into data and returns how many were
+  // popped. The elements are claimed with a single update of the front index
+  std::size_t PopBulk(std::span<StorageT> data) {
+    auto const [pos, count] = Claim(front_, 1, data.size());
+    for (std::size_t i = 0; i < count; ++i) {
+      auto& cell = cells_[(pos + i) & MASK];
+      data[i] = cell.data.Take();
+      Release(cell, pos + i);
+    }
+    return count;
+  }
+
+  // Claims every element that is ready and calls function on each of them in
+  // place. Slots are handed back to producers as soon as they are processed
+  template <class Function>
+  std::size_t ConsumeAll(Function&& function) {
+    auto const [pos, count] = Claim(front_, 1, BUFFER_SIZE(SIZE));
+    for (std::size_t i = 0; i < count; ++i) {
+      auto& cell = cells_[(pos + i) & MASK];
+      function(*cell.data.Get());
+      cell.data.Destroy();
+      Release(cell, pos + i);
+    }
+    return count;
+  }
+
+  // Only a snapshot as other threads may be pushing/popping concurrently
+  std::size_t Size() const {
+    auto const front = front_.load(std::memory_order_relaxed);
+    auto const back = back_.load(std::memory_order_relaxed);
+    return back > front ? back - front : 0;
+  }
+  // The slot sequence numbers require every slot to be usable, so the
+  // capacity is SIZE rounded up to a power of two
+  constexpr std::size_t Capacity() const { return BUFFER_SIZE(SIZE); }
+
+ private:
+  static constexpr std::uint64_t MASK = BUFFER_SIZE(SIZE) - 1;
+
+  struct Cell {
+    std::atomic_uint64_t sequence;
+    internal::Slot<StorageT> data;
+  };
+
+  Cell cells_[BUFFER_SIZE(SIZE)];
+  // Separate cache lines so producers and consumers do not contend
+  alignas(CACHE_LINE_SIZE) std::atomic_uint64_t front_{0};
+  alignas(CACHE_LINE_SIZE) std::atomic_uint64_t back_{0};
+
+  // Claims up to max consecutive positions from index with a single CAS.
+  // A slot at position pos is free to write when its sequence is pos and ready
+  // to read when it is pos + 1, so offset selects which of these is claimed.
+  // Returns the first position claimed and the number of positions
+  std::pair<std::uint64_t, std::size_t> Claim(std::atomic_uint64_t& index,
+                                              std::uint64_t const offset,
+                                              std::size_t const max) {
+    auto pos = index.load(std::memory_order_relaxed);
+    while (true) {
+      std::size_t count = 0;
+      std::int64_t diff = 0;
+      for (; count < max; ++count) {
+        auto const sequence = cells_[(pos + count) & MASK].sequence.load(
+            std::memory_order_acquire);
+        diff = static_cast<std::int64_t>(sequence - (pos + count + offset));
+        if (diff != 0) {
+          break;
+        }
+      }
+
+      if (count > 0) {
+        if (index.compare_exchange_weak(pos, pos + count,
+                                        std::memory_order_relaxed)) {
+          return {pos, count};
+        }
+      } else if (diff < 0 || max == 0) {
+        // Queue is full (or empty) from the point of view of this index
+        return {pos, 0};
+      } else {
+        // Another thread claimed this position first
+        pos = index.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Hands a consumed slot back to producers for the next lap
+  void Release(Cell& cell, std::uint64_t const pos) {
+    cell.sequence.store(pos + BUFFER_SIZE(SIZE), std::memory_order_release);
+  }
+};
+
+// Bounded single-producer/single-consumer queue. The producer and consumer
+// indices live on separate cache lines and each side keeps a cached copy of
+// the other's index, so the shared line is only read when the queue appears
+// full (producer) or empty (consumer)
+template <class T, const std::size_t SIZE>
+class Queue<T, SIZE, queue_policy::SPSC> {
+  typedef typename std::remove_const<T>::type StorageT;
+
+ public:
+  Queue() = default;
+  ~Queue() {
+    for (auto pos = front_.load(); pos != back_.load(); ++pos) {
+      data_[pos & MASK].Destroy();
+    }
+  }
+
+  Queue(const Queue&) = delete;
+  Queue& operator=(const Queue&) = delete;
+  Queue(Queue&&) = delete;
+  Queue& operator=(Queue&&) = delete;
+
+  // Should only be called by the consumer
+  T& Front() const {
+    return *data_[front_.load(std::memory_order_relaxed) & MASK].Get();
+  }
+
+  // Returns false if the queue is full. Should only be called by the producer
+  template <class... Args>
+  bool TryEmplace(Args&&... args) {
+    auto const back = back_.load(std::memory_order_relaxed);
+    if (back - frontCache_ >= SIZE) {
+      frontCache_ = front_.load(std::memory_order_acquire);
+      if (back - frontCache_ >= SIZE) {
+        return false;
+      }
+    }
+    data_[back & MASK].Construct(std::forward<Args>(args)...);
+    back_.store(back + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool TryPush(StorageT&& data) { return TryEmplace(std::move(data)); }
+  bool TryPush(const StorageT& data) { return TryEmplace(data); }
+
+  // Returns an empty optional if the queue is empty. Should only be called by
+  // the consumer
+  std::optional<StorageT> TryPop() {
+    auto const front = front_.load(std::memory_order_relaxed);
+    if (front == backCache_) {
+      backCache_ = back_.load(std::memory_order_acquire);
+      if (front == backCache_) {
+        return std::nullopt;
+      }
+    }
+    std::optional<StorageT> data{data_[front & MASK].Take()};
+    front_.store(front + 1, std::memory_order_release);
+    return data;
+  }
+
+  // Returns false if the queue is empty, otherwise moves front into data
+  bool TryPop(StorageT& data) {
+    auto popped = TryPop();
+    if (popped) {
+      data = std::move(*popped);
+    }
+    return popped.has_value();
+  }
+
+  template <class... Args>
+  void Emplace(Args&&... args) {
+    [[maybe_unused]] auto const pushed =
+        TryEmplace(std::forward<Args>(args)...);
+    assert(pushed);
+  }
+
+  void Push(StorageT&& data) { Emplace(std::move(data)); }
+  void Push(const StorageT& data) { Emplace(data); }
+
+  StorageT Pop() {
+    auto data = TryPop();
+    assert(data);
+    return std::move(*data);
+  }
+
+  // Moves as many elements from data as fit and returns how many were pushed.
+  // Should only be called by the producer
+  std::size_t PushBulk(std::span<StorageT> data) {
+    auto const back = back_.load(std::memory_order_relaxed);
+    if (SIZE - (back - frontCache_) < data.size()) {
+      frontCache_ = front_.load(std::memory_order_acquire);
+    }
+    auto const count = std::min(data.size(), SIZE - (back - frontCache_));
+    for (std::size_t i = 0; i < count; ++i) {
+      data_[(back + i) & MASK].Construct(std::move(data[i]));
+    }
+    back_.store(back + count, std::memory_order_release);
+    return count;
+  }
+
+  // Moves up to data.size() elements into data and returns how many were
+  // popped. Should only be called by the consumer
+  std::size_t PopBulk(std::span<StorageT> data) {
+    auto const front = front_.load(std::memory_order_relaxed);
+    if (backCache_ - front < data.size()) {
+      backCache_ = back_.load(std::memory_order_acquire);
+    }
+    auto const count = std::min<std::size_t>(data.size(), backCache_ - front);
+    for (std::size_t i = 0; i < count; ++i) {
+      data[i] = data_[(front + i) & MASK].Take();
+    }
+    front_.store(front + count, std::memory_order_release);
+    return count;
+  }
+
+  // Calls function on every element currently in the queue, removing them.
+  // Should only be called by the consumer
+  template <class Function>
+  std::size_t ConsumeAll(Function&& function) {
+    auto const front = front_.load(std::memory_order_relaxed);
+    backCache_ = back_.load(std::memory_order_acquire);
+    auto const count = backCache_ - front;
+    for (std::size_t i = 0; i < count; ++i) {
+      auto& slot = data_[(front + i) & MASK];
+      function(*slot.Get());
+      slot.Destroy();
+    }
+    front_.store(backCache_, std::memory_order_release);
+    return count;
   }
 
   std::size_t Size() const {
-    return (back_ - front_ + REAL_SIZE(SIZE)) % REAL_SIZE(SIZE);
+    auto const front = front_.load(std::memory_order_acquire);
+    return back_.load(std::memory_order_acquire) - front;
   }
   constexpr std::size_t Capacity() const { return SIZE; }
 
  private:
-  mutable StorageT data_[REAL_SIZE(SIZE)];
-  std::atomic_size_t front_{0};
-  std::atomic_size_t back_{0};
+  static constexpr std::uint64_t MASK = BUFFER_SIZE(SIZE) - 1;
+
+  // Owned by the consumer
+  alignas(CACHE_LINE_SIZE) std::atomic_uint64_t front_{0};
+  std::uint64_t backCache_ = 0;
+  // Owned by the producer
+  alignas(CACHE_LINE_SIZE) std::atomic_uint64_t back_{0};
+  std::uint64_t frontCache_ = 0;
+
+  alignas(CACHE_LINE_SIZE) mutable internal::Slot<StorageT> data_[BUFFER_SIZE(
+      SIZE)];
+};
+
+// Unbounded queue built from fixed size segments of SIZE elements linked
+// together. When the back segment fills up a new one is linked in, so pushing
+// never fails or waits on consumers. Producers and consumers each have their
+// own lock (only held while moving an element in or out) so the two sides do
+// not contend with each other. Emptied segments are recycled through a free
+// list, so once a burst is over no more allocations are made and anything
+// beyond MAX_FREE_SEGMENTS is returned to the system
+template <class T, const std::size_t SIZE>
+class Queue<T, SIZE, queue_policy::Unbounded> {
+  typedef typename std::remove_const<T>::type StorageT;
+
+ public:
+  static constexpr std::size_t MAX_FREE_SEGMENTS = 8;
+
+  Queue() : frontSegment_(new Segment), backSegment_(frontSegment_) {}
+  ~Queue() {
+    for (auto pos = front_.load(); pos != back_.load(); ++pos) {
+      FrontSlot(pos).Destroy();
+    }
+    DeleteSegments(frontSegment_);
+    DeleteSegments(freeList_);
+  }
+
+  Queue(const Queue&) = delete;
+  Queue& operator=(const Queue&) = delete;
+  Queue(Queue&&) = delete;
+  Queue& operator=(Queue&&) = delete;
+
+  template <class... Args>
+  void Emplace(Args&&... args) {
+    std::unique_lock lock(backMutex_);
+    auto const back = back_.load(std::memory_order_relaxed);
+    BackSlot(back).Construct(std::forward<Args>(args)...);
+    back_.store(back + 1, std::memory_order_release);
+  }
+
+  void Push(StorageT&& data) { Emplace(std::move(data)); }
+  void Push(const StorageT& data) { Emplace(data); }
+
+  // Never fails but provided so it can be used in place of bounded queues
+  template <class... Args>
+  bool TryEmplace(Args&&... args) {
+    Emplace(std::forward<Args>(args)...);
+    return true;
+  }
+
+  bool TryPush(StorageT&& data) { return TryEmplace(std::move(data)); }
+  bool TryPush(const StorageT& data) { return TryEmplace(data); }
+
+  // Returns an empty optional if the queue is empty
+  std::optional<StorageT> TryPop() {
+    std::unique_lock lock(frontMutex_);
+    auto const front = front_.load(std::memory_order_relaxed);
+    if (front == back_.load(std::memory_order_acquire)) {
+      return std::nullopt;
+    }
+    std::optional<StorageT> data{FrontSlot(front).Take()};
+    front_.store(front + 1, std::memory_order_release);
+    return data;
+  }
+
+  // Returns false if the queue is empty, otherwise moves front into data
+  bool TryPop(StorageT& data) {
+    auto popped = TryPop();
+    if (popped) {
+      data = std::move(*popped);
+    }
+    return popped.has_value();
+  }
+
+  StorageT Pop() {
+    auto data = TryPop();
+    assert(data);
+    return std::move(*data);
+  }
+
+  // Pushes every element in data and returns how many were pushed
+  std::size_t PushBulk(std::span<StorageT> data) {
+    std::unique_lock lock(backMutex_);
+    auto const back = back_.load(std::memory_order_relaxed);
+    for (std::size_t i = 0; i < data.size(); ++i) {
+      BackSlot(back + i).Construct(std::move(data[i]));
+    }
+    back_.store(back + data.size(), std::memory_order_release);
+    return data.size();
+  }
+
+  // Moves up to data.size() elements into data and returns how many were popped
+  std::size_t PopBulk(std::span<StorageT> data) {
+    std::unique_lock lock(frontMutex_);
+    auto const front = front_.load(std::memory_order_relaxed);
+    auto const count = std::min<std::size_t>(
+        data.size(), back_.load(std::memory_order_acquire) - front);
+    for (std::size_t i = 0; i < count; ++i) {
+      data[i] = FrontSlot(front + i).Take();
+    }
+    front_.store(front + count, std::memory_order_release);
+    return count;
+  }
+
+  // Calls function on every element currently in the queue, removing them
+  template <class Function>
+  std::size_t ConsumeAll(Function&& function) {
+    std::unique_lock lock(frontMutex_);
+    auto const front = front_.load(std::memory_order_relaxed);
+    auto const back = back_.load(std::memory_order_acquire);
+    for (auto pos = front; pos != back; ++pos) {
+      auto& slot = FrontSlot(pos);
+      function(*slot.Get());
+      slot.Destroy();
+    }
+    front_.store(back, std::memory_order_release);
+    return back - front;
+  }
+
+  // Only a snapshot as other threads may be pushing/popping concurrently
+  std::size_t Size() const {
+    auto const front = front_.load(std::memory_order_acquire);
+    return back_.load(std::memory_order_acquire) - front;
+  }
+  constexpr std::size_t Capacity() const {
+    return std::numeric_limits<std::size_t>::max();
+  }
+
+  // Allocates segments onto the free list (up to MAX_FREE_SEGMENTS) so the
+  // next pushes do not allocate. The memory is zeroed by the calling thread,
+  // so with first-touch NUMA placement it ends up on that thread's node
+  void Reserve(std::size_t const segments) {
+    std::unique_lock lock(freeListMutex_);
+    while (freeListSize_ < std::min(segments, MAX_FREE_SEGMENTS)) {
+      auto segment = new Segment();
+      segment->next.store(freeList_, std::memory_order_relaxed);
+      freeList_ = segment;
+      ++freeListSize_;
+    }
+  }
+
+ private:
+  static constexpr std::uint64_t MASK = BUFFER_SIZE(SIZE) - 1;
+
+  struct Segment {
+    internal::Slot<StorageT> data[BUFFER_SIZE(SIZE)];
+    std::atomic<Segment*> next{nullptr};
+  };
+
+  // Owned by consumers
+  alignas(CACHE_LINE_SIZE) std::mutex frontMutex_;
+  Segment* frontSegment_;
+  std::atomic_uint64_t front_{0};
+  // Owned by producers
+  alignas(CACHE_LINE_SIZE) std::mutex backMutex_;
+  Segment* backSegment_;
+  std::atomic_uint64_t back_{0};
+
+  alignas(CACHE_LINE_SIZE) std::mutex freeListMutex_;
+  Segment* freeList_ = nullptr;
+  std::size_t freeListSize_ = 0;
+
+  // Must hold backMutex_. Links in a new segment when the last one is full
+  internal::Slot<StorageT>& BackSlot(std::uint64_t const pos) {
+    if (pos != 0 && (pos & MASK) == 0) {
+      auto segment = AllocateSegment();
+      backSegment_->next.store(segment, std::memory_order_release);
+      backSegment_ = segment;
+    }
+    return backSegment_->data[pos & MASK];
+  }
+
+  // Must hold frontMutex_ and pos must be before back_. Moves on to the next
+  // segment (which will already be linked) once the current one is used up
+  internal::Slot<StorageT>& FrontSlot(std::uint64_t const pos) {
+    if (pos != 0 && (pos & MASK) == 0) {
+      auto next = frontSegment_->next.load(std::memory_order_acquire);
+      RecycleSegment(frontSegment_);
+      frontSegment_ = next;
+    }
+    return frontSegment_->data[pos & MASK];
+  }
+
+  Segment* AllocateSegment() {
+    {
+      std::unique_lock lock(freeListMutex_);
+      if (freeList_) {
+        auto segment = freeList_;
+        freeList_ = segment->next.load(std::memory_order_relaxed);
+        --freeListSize_;
+        segment->next.store(nullptr, std::memory_order_relaxed);
+        return segment;
+      }
+    }
+    return new Segment;
+  }
+
+  void RecycleSegment(Segment* segment) {
+    {
+      std::unique_lock lock(freeListMutex_);
+      if (freeListSize_ < MAX_FREE_SEGMENTS) {
+        segment->next.store(freeList_, std::memory_order_relaxed);
+        freeList_ = segment;
+        ++freeListSize_;
+        return;
+      }
+    }
+    delete segment;
+  }
+
+  static void DeleteSegments(Segment* segment) {
+    while (segment) {
+      auto next = segment->next.load(std::memory_order_relaxed);
+      delete segment;
+      segment = next;
+    }
+  }
 };
 
 }  // namespace async_lib
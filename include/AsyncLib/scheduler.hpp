@@ -0,0 +1,310 @@
+#ifndef ASYNC_LIB_SCHEDULER_HPP
+#define ASYNC_LIB_SCHEDULER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <optional>
+#include <random>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "AsyncLib/event.hpp"
+#include "AsyncLib/queue.hpp"
+
+namespace async_lib {
+
+// Chase-Lev work-stealing deque (using the C11 memory orderings from Le et al.
+// 2013). The owning thread pushes and pops at the bottom like a stack while
+// any other thread can steal from the top. Only trivially copyable types can
+// be stored as a stealer may read a slot that is being overwritten
+template <class T>
+class WorkStealingDeque {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "WorkStealingDeque can only store trivially copyable types");
+
+ public:
+  explicit WorkStealingDeque(std::size_t const capacity = 256) {
+    buffers_.push_back(std::make_unique<Buffer>(std::bit_ceil(capacity)));
+    buffer_.store(buffers_.back().get(), std::memory_order_relaxed);
+  }
+  ~WorkStealingDeque() = default;
+
+  WorkStealingDeque(WorkStealingDeque const&) = delete;
+  WorkStealingDeque& operator=(WorkStealingDeque const&) = delete;
+  WorkStealingDeque(WorkStealingDeque&&) = delete;
+  WorkStealingDeque& operator=(WorkStealingDeque&&) = delete;
+
+  // Should only be called by the owning thread
+  void Push(T item) {
+    auto const bottom = bottom_.load(std::memory_order_relaxed);
+    auto const top = top_.load(std::memory_order_acquire);
+    auto buffer = buffer_.load(std::memory_order_relaxed);
+    if (bottom - top >= buffer->Capacity()) {
+      buffer = Grow(buffer, top, bottom);
+    }
+    buffer->Put(bottom, item);
+    bottom_.store(bottom + 1, std::memory_order_release);
+  }
+
+  // Should only be called by the owning thread. Returns the newest item
+  std::optional<T> Pop() {
+    auto const bottom = bottom_.load(std::memory_order_relaxed) - 1;
+    auto buffer = buffer_.load(std::memory_order_relaxed);
+    bottom_.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto top = top_.load(std::memory_order_relaxed);
+
+    std::optional<T> item;
+    if (top <= bottom) {
+      item = buffer->Get(bottom);
+      if (top == bottom) {
+        // Last item so race any stealers for it
+        if (!top_.compare_exchange_strong(top, top + 1,
+                                          std::memory_order_seq_cst,
+                                          std::memory_order_relaxed)) {
+          item.reset();
+        }
+        bottom_.store(bottom + 1, std::memory_order_relaxed);
+      }
+    } else {
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return item;
+  }
+
+  // Can be called from any thread. Returns the oldest item, or nothing if the
+  // deque is empty or another thread won the race for it
+  std::optional<T> Steal() {
+    auto top = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto const bottom = bottom_.load(std::memory_order_acquire);
+    if (top >= bottom) {
+      return std::nullopt;
+    }
+
+    auto const item = buffer_.load(std::memory_order_acquire)->Get(top);
+    if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                      std::memory_order_relaxed)) {
+      return std::nullopt;
+    }
+    return item;
+  }
+
+  // Only a snapshot as other threads may be stealing concurrently
+  std::size_t Size() const {
+    auto const top = top_.load(std::memory_order_relaxed);
+    auto const bottom = bottom_.load(std::memory_order_relaxed);
+    return bottom > top ? bottom - top : 0;
+  }
+
+ private:
+  class Buffer {
+   public:
+    explicit Buffer(std::size_t const capacity)
+        : mask_(capacity - 1),
+          data_(std::make_unique<std::atomic<T>[]>(capacity)) {}
+
+    std::int64_t Capacity() const { return mask_ + 1; }
+    T Get(std::int64_t const index) const {
+      return data_[index & mask_].load(std::memory_order_relaxed);
+    }
+    void Put(std::int64_t const index, T item) {
+      data_[index & mask_].store(item, std::memory_order_relaxed);
+    }
+
+   private:
+    std::int64_t mask_;
+    std::unique_ptr<std::atomic<T>[]> data_;
+  };
+
+  alignas(CACHE_LINE_SIZE) std::atomic_int64_t top_{0};
+  alignas(CACHE_LINE_SIZE) std::atomic_int64_t bottom_{0};
+  std::atomic<Buffer*> buffer_;
+  // Stealers may still be reading old buffers so they are kept until the
+  // deque is destroyed. Only touched by the owner
+  std::vector<std::unique_ptr<Buffer>> buffers_;
+
+  Buffer* Grow(Buffer* buffer, std::int64_t const top,
+               std::int64_t const bottom) {
+    buffers_.push_back(std::make_unique<Buffer>(buffer->Capacity() * 2));
+    auto newBuffer = buffers_.back().get();
+    for (auto i = top; i < bottom; ++i) {
+      newBuffer->Put(i, buffer->Get(i));
+    }
+    buffer_.store(newBuffer, std::memory_order_release);
+    return newBuffer;
+  }
+};
+
+namespace internal {
+
+class SchedulerTask {
+ public:
+  virtual ~SchedulerTask() = default;
+  virtual void Run() = 0;
+};
+
+template <class R>
+class PackagedSchedulerTask : public SchedulerTask {
+ public:
+  explicit PackagedSchedulerTask(std::packaged_task<R()>&& task)
+      : task_(std::move(task)) {}
+
+  void Run() override { task_(); }
+
+ private:
+  std::packaged_task<R()> task_;
+};
+
+}  // namespace internal
+
+// Runs submitted tasks on a fixed set of threads. Each thread has its own
+// work-stealing deque: tasks submitted from a scheduler thread go onto that
+// thread's deque, tasks from anywhere else go onto a shared queue, and idle
+// threads steal from randomly chosen victims before going to sleep
+class Scheduler {
+ public:
+  explicit Scheduler(std::uint32_t const numThreads = DefaultThreadCount()) {
+    for (std::uint32_t i = 0; i < std::max(numThreads, 1u); ++i) {
+      deques_.push_back(
+          std::make_unique<WorkStealingDeque<internal::SchedulerTask*>>());
+    }
+    for (std::size_t i = 0; i < deques_.size(); ++i) {
+      threads_.emplace_back([this, i]() { RunThread(i); });
+    }
+  }
+
+  // Finishes every submitted task before returning
+  ~Scheduler() {
+    active_ = false;
+    work_event_.NotifyAll();
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+    // Catch anything a thread gave up on while shutting down
+    for (std::size_t i = 0; i < deques_.size(); ++i) {
+      while (auto task = FindTask(i)) {
+        RunTask(*task);
+      }
+    }
+  }
+
+  Scheduler(Scheduler const&) = delete;
+  Scheduler& operator=(Scheduler const&) = delete;
+  Scheduler(Scheduler&&) = delete;
+  Scheduler& operator=(Scheduler&&) = delete;
+
+  template <class Function>
+  auto Submit(Function&& function) {
+    typedef std::invoke_result_t<std::decay_t<Function>&> R;
+    std::packaged_task<R()> task(std::forward<Function>(function));
+    auto future = task.get_future();
+    Schedule(new internal::PackagedSchedulerTask<R>(std::move(task)));
+    return future;
+  }
+
+  std::uint32_t ThreadCount() const { return threads_.size(); }
+
+  static std::uint32_t DefaultThreadCount() {
+    return std::max(std::thread::hardware_concurrency(), 1u);
+  }
+
+ private:
+  std::vector<std::unique_ptr<WorkStealingDeque<internal::SchedulerTask*>>>
+      deques_;
+  Queue<internal::SchedulerTask*, DEFAULT_QUEUE_SIZE, queue_policy::Unbounded>
+      injection_queue_;
+  std::vector<std::thread> threads_;
+  std::atomic_bool active_{true};
+  // Signalled when work is added for threads that are asleep
+  Event work_event_;
+
+  // Which scheduler and deque the current thread belongs to
+  inline static thread_local Scheduler* current_scheduler_ = nullptr;
+  inline static thread_local std::size_t current_index_ = 0;
+
+  // Number of rounds of stealing attempted before going to sleep
+  static constexpr std::uint32_t STEAL_ROUNDS = 4;
+
+  void Schedule(internal::SchedulerTask* task) {
+    if (current_scheduler_ == this) {
+      deques_[current_index_]->Push(task);
+    } else {
+      injection_queue_.Push(task);
+    }
+    work_event_.NotifyOne();
+  }
+
+  static void RunTask(internal::SchedulerTask* task) {
+    std::unique_ptr<internal::SchedulerTask>(task)->Run();
+  }
+
+  std::optional<internal::SchedulerTask*> FindTask(std::size_t const index) {
+    if (auto task = deques_[index]->Pop()) {
+      return task;
+    }
+    return injection_queue_.TryPop();
+  }
+
+  std::optional<internal::SchedulerTask*> StealTask(std::size_t const index,
+                                                    std::minstd_rand& random) {
+    if (deques_.size() < 2) {
+      return std::nullopt;
+    }
+    // Start from a random victim but visit all of them so no work is missed
+    auto const start = random();
+    for (std::uint32_t i = 0; i < STEAL_ROUNDS * deques_.size(); ++i) {
+      auto const victim = (start + i) % deques_.size();
+      if (victim == index) {
+        continue;
+      }
+      if (auto task = deques_[victim]->Steal()) {
+        return task;
+      }
+    }
+    return std::nullopt;
+  }
+
+  void RunThread(std::size_t const index) {
+    current_scheduler_ = this;
+    current_index_ = index;
+    std::minstd_rand random(index + 1);
+
+    while (true) {
+      auto task = FindTask(index);
+      if (!task) {
+        task = StealTask(index, random);
+      }
+      if (task) {
+        RunTask(*task);
+        continue;
+      }
+
+      auto const token = work_event_.PrepareWait();
+      task = FindTask(index);
+      if (!task) {
+        task = StealTask(index, random);
+      }
+      if (!task && !active_) {
+        work_event_.FinishWait();
+        break;
+      }
+      if (!task) {
+        work_event_.Wait(token);
+      }
+      work_event_.FinishWait();
+      if (task) {
+        RunTask(*task);
+      }
+    }
+  }
+};
+
+}  // namespace async_lib
+
+#endif  // ASYNC_LIB_SCHEDULER_HPP
@@ -1,26 +1,105 @@
 #ifndef ASYNC_LIB_WORKER_HPP
 #define ASYNC_LIB_WORKER_HPP
 
-#include <condition_variable>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <functional>
 #include <mutex>
+#include <optional>
+#include <string>
 #include <thread>
+#include <vector>
 
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "AsyncLib/event.hpp"
+#include "AsyncLib/future.hpp"
+#include "AsyncLib/inplace_function.hpp"
 #include "AsyncLib/queue.hpp"
 
 namespace async_lib {
 
+// What AddJob should do when the queue is full
+enum class Backpressure {
+  BLOCK,            // Wait until the worker frees up space
+  SPIN_THEN_BLOCK,  // Retry spinCount times before waiting
+  DROP_NEWEST,      // Discard the job being added
+  DROP_OLDEST,      // Discard the job at the front of the queue to make space
+  FAIL              // Return false without adding the job
+};
+
+// How an idle worker thread waits for new jobs
+enum class WaitStrategy {
+  BUSY_SPIN,  // Lowest latency but burns a whole core
+  YIELD,      // Spins but gives up its time slice on each check
+  PARK        // Spins parkSpinCount times and then sleeps until woken
+};
+
+// How Stop treats jobs that are still queued
+enum class StopMode {
+  IMMEDIATE,  // Discard them once the threads finish their current batch
+  DRAIN_ALL,  // Process all of them before stopping
+  DEADLINE    // Process them until the timeout expires then discard the rest
+};
+
+struct WorkerOptions {
+  Backpressure backpressure = Backpressure::BLOCK;
+  std::uint32_t spinCount = 1000;
+
+  WaitStrategy waitStrategy = WaitStrategy::PARK;
+  std::uint32_t parkSpinCount = 64;
+
+  // Threads started by StartThread and the most that may run at once
+  std::uint32_t minThreads = 1;
+  std::uint32_t maxThreads = 1;
+  // Another thread is started if more jobs than this are waiting or a thread
+  // has been busy for longer than scaleUpLatency without emptying the queue
+  std::size_t scaleUpQueueDepth = 64;
+  std::chrono::milliseconds scaleUpLatency{10};
+  // Threads above minThreads exit after being idle for this long
+  std::chrono::milliseconds idleTimeout{1000};
+
+  // Placement of the worker threads, only applied on Linux. Threads are
+  // pinned to the cores in cpuAffinity (any core if empty), run with
+  // schedPolicy (e.g. SCHED_FIFO) at schedPriority and named threadName
+  // (truncated to 15 characters)
+  std::vector<int> cpuAffinity{};
+  std::optional<int> schedPolicy{};
+  int schedPriority = 0;
+  std::string threadName{};
+  // Number of unbounded queue segments the first thread allocates once it has
+  // been placed. With the default first-touch NUMA policy this puts them on
+  // the node of the pinned core
+  std::size_t reserveSegments = 0;
+
+  // Called from a worker thread each time it empties the queue, e.g. to write
+  // out anything buffered while processing a batch of jobs
+  std::function<void()> onIdle{};
+  // Called from a worker thread at most every tickInterval while it is busy
+  // with jobs, for periodic work that cannot wait until it is idle
+  std::function<void()> onTick{};
+  std::chrono::milliseconds tickInterval{10};
+};
+
 // TODO: implement way to update the function?
-// TODO: Add abiity to run several threads (automaticcally scale on queue size)
-template <class T>
+// Jobs are stored in an unbounded queue by default so adding a job never fails
+template <class T,
+          class QueueT =
+              Queue<const T, DEFAULT_QUEUE_SIZE, queue_policy::Unbounded>>
 class Worker {
+  typedef typename std::remove_const<T>::type JobT;
+
  public:
-  explicit Worker(std::function<void(T&)> function) : function_(function) {}
+  explicit Worker(std::function<void(T&)> function,
+                  WorkerOptions const& options = {})
+      : function_(function), options_(options) {}
 
-  ~Worker() {
-    KillThread();
-    Flush();
-  }
+  ~Worker() { Stop(StopMode::DRAIN_ALL); }
 
   // TODO: implement these
   Worker(const Worker&) = delete;
@@ -28,47 +107,489 @@ class Worker {
   Worker(Worker&&) = delete;
   Worker& operator=(Worker&&) = delete;
 
-  void AddJob(T job) {
-    queue_.Push(job);
-    queue_wait_cv_.notify_all();
+  // Returns false if the job was not added because the queue was full. If it
+  // blocks with no thread running, the queued jobs are processed on this
+  // thread to make space, as Drain does
+  bool AddJob(JobT job) {
+    // Counted before pushing so a job can never complete before it is added
+    ++added_jobs_;
+    auto const added = queue_.TryPush(std::move(job)) || HandleFullQueue(job);
+    if (!added) {
+      CompleteJobs(1);
+    } else if (options_.waitStrategy == WaitStrategy::PARK) {
+      // Only makes a syscall if a worker thread is actually asleep
+      job_event_.NotifyOne();
+    }
+    return added;
   }
 
-  void Flush() {
-    while (queue_.Size() > 0) {
-      auto job = queue_.Pop();
-      function_(job);
+  // Waits until every job added before the call has been processed. If the
+  // threads are running they do the work, otherwise it is done on this thread.
+  // Returns false if the timeout expired first
+  bool Drain(std::optional<std::chrono::nanoseconds> const timeout = {}) {
+    std::optional<std::chrono::steady_clock::time_point> deadline;
+    if (timeout) {
+      deadline = std::chrono::steady_clock::now() + *timeout;
+    }
+    auto const target = added_jobs_.load();
+
+    while (completed_jobs_ < target) {
+      if (!thread_active_) {
+        ProcessJobsUntil(deadline);
+      }
+      auto const token = drained_event_.PrepareWait();
+      auto finished = completed_jobs_ >= target;
+      if (!finished && deadline) {
+        auto const remaining = *deadline - std::chrono::steady_clock::now();
+        if (remaining.count() <= 0) {
+          drained_event_.FinishWait();
+          return false;
+        }
+        if (thread_active_) {
+          drained_event_.Wait(token, remaining);
+        }
+      } else if (!finished && thread_active_) {
+        drained_event_.Wait(token);
+      }
+      drained_event_.FinishWait();
+      if (!finished && !thread_active_) {
+        // Another thread is still pushing a job it has counted
+        std::this_thread::yield();
+      }
     }
+    return true;
   }
 
+  // Waits for all jobs added so far to be processed (see Drain)
+  void Flush() { Drain(); }
+
+  // Stops the threads, handling queued jobs according to mode, and returns the
+  // number of jobs that were discarded. The timeout is only used by DEADLINE
+  std::uint64_t Stop(
+      StopMode const mode,
+      std::optional<std::chrono::nanoseconds> const timeout = {}) {
+    switch (mode) {
+      case StopMode::DRAIN_ALL:
+        Drain();
+        KillThread();
+        // Catch anything added while the threads were stopping
+        Drain();
+        return 0;
+      case StopMode::DEADLINE:
+        Drain(timeout);
+        break;
+      case StopMode::IMMEDIATE:
+        break;
+    }
+    // Threads skip the rest of their current batch rather than process it
+    auto const discardedBefore = discarded_jobs_.load();
+    discard_jobs_ = true;
+    KillThread();
+    DiscardJobs();
+    discard_jobs_ = false;
+    return discarded_jobs_ - discardedBefore;
+  }
+
+  // Number of jobs discarded or rejected because the queue was full
+  std::uint64_t DroppedJobs() const { return dropped_jobs_; }
+
+  // Starts minThreads threads, which will scale up to maxThreads as needed
   void StartThread() {
     KillThread();
     thread_active_ = true;
-    thread_ = std::make_unique<std::thread>([&]() {
-      while (thread_active_) {
-        if (queue_.Size() == 0) {
-          std::unique_lock<std::mutex> lock(queue_wait_mutex_);
-          queue_wait_cv_.wait(lock);
-        }
-        Flush();
-      }
-    });
+    for (std::uint32_t i = 0; i < std::max(options_.minThreads, 1u); ++i) {
+      SpawnThread();
+    }
   }
 
+  // Stops the threads once they finish their current batch, leaving any other
+  // jobs in the queue
   void KillThread() {
     thread_active_ = false;
-    queue_wait_cv_.notify_all();
-    if (thread_ && thread_->joinable()) {
-      thread_->join();
+    job_event_.NotifyAll();
+    // Drain may be waiting for the threads and now needs to do the work itself
+    drained_event_.NotifyAll();
+
+    std::vector<std::thread> threads;
+    {
+      std::unique_lock lock(threads_mutex_);
+      threads.swap(threads_);
+      finished_threads_.clear();
+    }
+    for (auto& thread : threads) {
+      if (thread.joinable()) {
+        thread.join();
+      }
     }
+    thread_count_ = 0;
   }
 
+  std::uint32_t ThreadCount() const { return thread_count_; }
+
+  // Number of times a thread could not be given the requested affinity,
+  // scheduling policy or name (e.g. SCHED_FIFO without CAP_SYS_NICE)
+  std::uint64_t PlacementErrors() const { return placement_errors_; }
+
  private:
-  Queue<const T> queue_;
+  // Jobs can be added from any thread so needs to be multi-producer safe
+  QueueT queue_;
   std::function<void(T&)> function_;
-  std::unique_ptr<std::thread> thread_;
-  bool thread_active_;
-  std::condition_variable queue_wait_cv_;
-  std::mutex queue_wait_mutex_;
+  WorkerOptions options_;
+  std::atomic_uint64_t dropped_jobs_{0};
+  // Signalled when space is freed for producers blocked on a full queue
+  Event space_event_;
+  // Signalled when jobs are added for parked worker threads
+  Event job_event_;
+  // Signalled when jobs complete for threads waiting in Drain
+  Event drained_event_;
+  // Jobs are complete once processed, dropped or discarded. Kept on separate
+  // cache lines as producers and worker threads update them independently
+  alignas(CACHE_LINE_SIZE) std::atomic_uint64_t added_jobs_{0};
+  alignas(CACHE_LINE_SIZE) std::atomic_uint64_t completed_jobs_{0};
+  std::vector<std::thread> threads_;
+  // Threads that have retired but have not yet been joined
+  std::vector<std::thread::id> finished_threads_;
+  std::mutex threads_mutex_;
+  std::atomic_uint32_t thread_count_{0};
+  std::atomic_bool thread_active_{false};
+  // Set while Stop is throwing away queued jobs
+  std::atomic_bool discard_jobs_{false};
+  std::atomic_uint64_t discarded_jobs_{0};
+  std::atomic_uint64_t placement_errors_{0};
+  std::once_flag reserve_flag_;
+
+  // How many jobs a thread processes between checks for scaling up or a tick
+  static constexpr std::uint32_t SCALE_CHECK_INTERVAL = 32;
+
+  void SpawnThread() {
+    std::unique_lock lock(threads_mutex_);
+    if (!thread_active_ ||
+        thread_count_ >= std::max(options_.maxThreads, 1u)) {
+      return;
+    }
+    JoinFinishedThreads();
+    ++thread_count_;
+    threads_.emplace_back([this]() { RunThread(); });
+  }
+
+  // Must hold threads_mutex_
+  void JoinFinishedThreads() {
+    for (auto const& id : finished_threads_) {
+      auto thread = std::find_if(threads_.begin(), threads_.end(),
+                                 [&](auto& t) { return t.get_id() == id; });
+      if (thread != threads_.end()) {
+        thread->join();
+        threads_.erase(thread);
+      }
+    }
+    finished_threads_.clear();
+  }
+
+  // Returns true if this thread should exit because there are more than enough
+  // threads running. The last thread never retires as AddJob does not start
+  // new ones
+  bool RetireThread() {
+    std::unique_lock lock(threads_mutex_);
+    if (!thread_active_ || thread_count_ <= std::max(options_.minThreads, 1u)) {
+      return false;
+    }
+    --thread_count_;
+    finished_threads_.push_back(std::this_thread::get_id());
+    return true;
+  }
+
+  void RunThread() {
+    PlaceThread();
+    auto lastTick = std::chrono::steady_clock::now();
+    while (thread_active_) {
+      if (!WaitForJobs() && RetireThread()) {
+        return;
+      }
+      ProcessJobs(lastTick);
+      if (options_.onIdle && queue_.Size() == 0) {
+        options_.onIdle();
+      }
+    }
+  }
+
+  void PlaceThread() {
+#ifdef __linux__
+    auto const self = pthread_self();
+    if (!options_.cpuAffinity.empty()) {
+      cpu_set_t cpus;
+      CPU_ZERO(&cpus);
+      for (auto const cpu : options_.cpuAffinity) {
+        CPU_SET(cpu, &cpus);
+      }
+      if (pthread_setaffinity_np(self, sizeof(cpus), &cpus) != 0) {
+        ++placement_errors_;
+      }
+    }
+    if (options_.schedPolicy) {
+      sched_param param{};
+      param.sched_priority = options_.schedPriority;
+      if (pthread_setschedparam(self, *options_.schedPolicy, &param) != 0) {
+        ++placement_errors_;
+      }
+    }
+    if (!options_.threadName.empty()) {
+      // Linux limits names to 16 bytes including the terminator
+      auto const name = options_.threadName.substr(0, 15);
+      if (pthread_setname_np(self, name.c_str()) != 0) {
+        ++placement_errors_;
+      }
+    }
+#endif
+    if constexpr (requires(QueueT& queue) { queue.Reserve(std::size_t{}); }) {
+      if (options_.reserveSegments > 0) {
+        std::call_once(reserve_flag_,
+                       [&]() { queue_.Reserve(options_.reserveSegments); });
+      }
+    }
+  }
+
+  bool HasJobs() const { return queue_.Size() > 0 || !thread_active_; }
+
+  // Returns false if no job arrived within idleTimeout
+  bool WaitForJobs() {
+    auto const deadline =
+        std::chrono::steady_clock::now() + options_.idleTimeout;
+    auto const timedOut = [&]() {
+      return std::chrono::steady_clock::now() >= deadline;
+    };
+
+    switch (options_.waitStrategy) {
+      case WaitStrategy::BUSY_SPIN:
+        for (std::uint32_t i = 1; !HasJobs(); ++i) {
+          // Avoid reading the clock on every spin
+          if (i % 1024 == 0 && timedOut()) {
+            return false;
+          }
+          CpuRelax();
+        }
+        return true;
+      case WaitStrategy::YIELD:
+        while (!HasJobs()) {
+          if (timedOut()) {
+            return false;
+          }
+          std::this_thread::yield();
+        }
+        return true;
+      case WaitStrategy::PARK:
+        break;
+    }
+
+    for (std::uint32_t i = 0; i < options_.parkSpinCount; ++i) {
+      if (HasJobs()) {
+        return true;
+      }
+      CpuRelax();
+    }
+    while (!HasJobs()) {
+      auto const token = job_event_.PrepareWait();
+      auto const remaining = deadline - std::chrono::steady_clock::now();
+      auto const woken = HasJobs() || (remaining.count() > 0 &&
+                                       job_event_.Wait(token, remaining));
+      job_event_.FinishWait();
+      if (!woken) {
+        return HasJobs();
+      }
+    }
+    return true;
+  }
+
+  void ProcessJobs(std::chrono::steady_clock::time_point& lastTick) {
+    if (options_.maxThreads <= 1) {
+      // Keep going as jobs may have been added while processing the last batch
+      std::size_t processed;
+      std::uint32_t sinceCheck = 0;
+      while (thread_active_ &&
+             (processed = queue_.ConsumeAll([&](T& job) {
+               RunJob(job);
+               if (++sinceCheck % SCALE_CHECK_INTERVAL == 0) {
+                 Tick(lastTick);
+               }
+             })) > 0) {
+        NotifySpace();
+        CompleteJobs(processed);
+      }
+      return;
+    }
+
+    // With several threads jobs are popped one at a time so a single thread
+    // cannot claim all of the waiting work
+    auto const busySince = std::chrono::steady_clock::now();
+    std::uint32_t processed = 0;
+    while (thread_active_) {
+      auto job = queue_.TryPop();
+      if (!job) {
+        break;
+      }
+      RunJob(*job);
+      NotifySpace();
+      CompleteJobs(1);
+      if (++processed % SCALE_CHECK_INTERVAL == 1) {
+        if (ShouldScaleUp(busySince)) {
+          SpawnThread();
+        }
+        Tick(lastTick);
+      }
+    }
+  }
+
+  // lastTick is per thread so each one keeps to tickInterval on its own
+  void Tick(std::chrono::steady_clock::time_point& lastTick) const {
+    if (!options_.onTick) {
+      return;
+    }
+    auto const now = std::chrono::steady_clock::now();
+    if (now - lastTick >= options_.tickInterval) {
+      lastTick = now;
+      options_.onTick();
+    }
+  }
+
+  bool ShouldScaleUp(std::chrono::steady_clock::time_point busySince) const {
+    return thread_count_ < options_.maxThreads &&
+           (queue_.Size() > options_.scaleUpQueueDepth ||
+            std::chrono::steady_clock::now() - busySince >
+                options_.scaleUpLatency);
+  }
+
+  // Only called once the first attempt to push has failed
+  bool HandleFullQueue(JobT& job) {
+    switch (options_.backpressure) {
+      case Backpressure::SPIN_THEN_BLOCK:
+        for (std::uint32_t i = 0; i < options_.spinCount; ++i) {
+          if (queue_.TryPush(std::move(job))) {
+            return true;
+          }
+          std::this_thread::yield();
+        }
+        [[fallthrough]];
+      case Backpressure::BLOCK:
+        return BlockUntilPushed(job);
+      case Backpressure::DROP_OLDEST:
+        while (!queue_.TryPush(std::move(job))) {
+          if (queue_.TryPop()) {
+            ++dropped_jobs_;
+            CompleteJobs(1);
+          }
+        }
+        return true;
+      case Backpressure::DROP_NEWEST:
+      case Backpressure::FAIL:
+        break;
+    }
+    ++dropped_jobs_;
+    return false;
+  }
+
+  bool BlockUntilPushed(JobT& job) {
+    while (true) {
+      if (!thread_active_) {
+        // Nothing else is going to make space
+        ProcessJobsUntil({});
+      }
+      auto const token = space_event_.PrepareWait();
+      auto const pushed = queue_.TryPush(std::move(job));
+      if (!pushed && thread_active_) {
+        space_event_.Wait(token);
+      }
+      space_event_.FinishWait();
+      if (pushed) {
+        return true;
+      }
+    }
+  }
+
+  // Processes jobs on the calling thread until the queue is empty or the
+  // deadline passes
+  void ProcessJobsUntil(
+      std::optional<std::chrono::steady_clock::time_point> const deadline) {
+    if (!deadline) {
+      std::size_t processed;
+      while ((processed = queue_.ConsumeAll(function_)) > 0) {
+        NotifySpace();
+        CompleteJobs(processed);
+      }
+      return;
+    }
+    while (std::chrono::steady_clock::now() < *deadline) {
+      auto job = queue_.TryPop();
+      if (!job) {
+        return;
+      }
+      function_(*job);
+      NotifySpace();
+      CompleteJobs(1);
+    }
+  }
+
+  void RunJob(T& job) {
+    if (discard_jobs_.load(std::memory_order_relaxed)) {
+      ++discarded_jobs_;
+    } else {
+      function_(job);
+    }
+  }
+
+  void DiscardJobs() {
+    std::uint64_t const discarded = queue_.ConsumeAll([](T&) {});
+    discarded_jobs_ += discarded;
+    NotifySpace();
+    CompleteJobs(discarded);
+  }
+
+  void CompleteJobs(std::uint64_t const count) {
+    if (count > 0) {
+      completed_jobs_ += count;
+      // Only makes a syscall if a thread is waiting in Drain
+      drained_event_.NotifyAll();
+    }
+  }
+
+  void NotifySpace() {
+    if (options_.backpressure == Backpressure::BLOCK ||
+        options_.backpressure == Backpressure::SPIN_THEN_BLOCK) {
+      space_event_.NotifyAll();
+    }
+  }
+};
+
+// Worker whose jobs are the callables themselves. Captures of up to CAPACITY
+// bytes are stored inline in the queue so adding a job does not allocate.
+// Larger ones still work but are moved to the heap
+template <const std::size_t CAPACITY = DEFAULT_INPLACE_FUNCTION_SIZE,
+          class QueueT = Queue<const InplaceFunction<void(), CAPACITY>,
+                               DEFAULT_QUEUE_SIZE, queue_policy::Unbounded>>
+class TaskWorker : public Worker<InplaceFunction<void(), CAPACITY>, QueueT> {
+ public:
+  typedef InplaceFunction<void(), CAPACITY> TaskT;
+
+  explicit TaskWorker(WorkerOptions const& options = {})
+      : Worker<TaskT, QueueT>([](TaskT& task) { task(); }, options) {}
+
+  using Worker<TaskT, QueueT>::AddJob;
+
+  // Adds function as a job and returns a Future for its result. If the job is
+  // dropped or discarded the future holds a broken_promise error instead
+  template <class Function,
+            class = std::enable_if_t<
+                !std::is_same_v<std::decay_t<Function>, TaskT>>>
+  auto AddJob(Function&& function) {
+    typedef std::invoke_result_t<std::decay_t<Function>&> R;
+    Promise<R> promise;
+    auto future = promise.GetFuture();
+    AddJob(TaskT([promise = std::move(promise),
+                  function = std::forward<Function>(function)]() mutable {
+      internal::SetPromise(promise, function);
+    }));
+    return future;
+  }
+
+  bool Submit(TaskT task) { return this->AddJob(std::move(task)); }
 };
 
 }  // namespace async_lib
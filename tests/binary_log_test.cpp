@@ -0,0 +1,76 @@
+#include "AsyncLib/binary_log.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+
+#include "AsyncLib/logger.hpp"
+#include "catch2/catch_test_macros.hpp"
+
+TEST_CASE("Binary log tests") {
+  auto const path = std::string("BinaryLogTest.bin");
+  auto decode = [&](std::string const& file) {
+    std::ifstream in(file, std::ios::binary);
+    std::ostringstream out;
+    auto const decoded = async_lib::DecodeBinaryLog(in, out);
+    return std::make_pair(decoded, out.str());
+  };
+
+  {
+    async_lib::internal::LoggerRegistry registry;
+    auto text = std::make_shared<std::ostringstream>();
+    registry.CreateSink("binary",
+                        std::make_shared<async_lib::BinarySink>(path));
+    registry.CreateSink("text", text);
+    registry.CreateLogger("Binary", "binary");
+    registry.AddSink("Binary", "text");
+    auto logger = registry.GetLogger("Binary");
+
+    SECTION("Decodes To Same Text As Text Sink") {
+      logger->Info("{} {} {} {}", 1, -2, 3.5, "four");
+      logger->Warn("{:>6}|{:.2f}|{}|{}", 'c', 1.5f, true, nullptr);
+      logger->SetLogFormat("{date} {thread} {seq} {level}: {message}");
+      logger->Error("{}", std::string("string"));
+      registry.FlushAll();
+      auto const [decoded, output] = decode(path);
+      REQUIRE(decoded);
+      REQUIRE(output == text->str());
+    }
+
+    SECTION("Same Format Can Be Used With Different Types") {
+      logger->SetLogFormat("{message}");
+      logger->Info("{}", 1);
+      logger->Info("{}", "one");
+      logger->Info("{}", 1);
+      registry.FlushAll();
+      REQUIRE(decode(path).second == "1\none\n1\n");
+    }
+
+    SECTION("Keeps Complete Logs If Cut Short") {
+      logger->SetLogFormat("{message}");
+      logger->Info("first");
+      logger->Info("second");
+      registry.FlushAll();
+      std::ifstream in(path, std::ios::binary);
+      std::string contents((std::istreambuf_iterator<char>(in)), {});
+      contents.resize(contents.size() - 2);
+      std::istringstream truncated(contents);
+      std::ostringstream out;
+      REQUIRE_FALSE(async_lib::DecodeBinaryLog(truncated, out));
+      REQUIRE(out.str() == "first\n");
+    }
+  }
+
+  SECTION("Rejects Files That Are Not Binary Logs") {
+    std::istringstream in("[0.1] [Text] [Info] log\n");
+    std::ostringstream out;
+    REQUIRE_FALSE(async_lib::DecodeBinaryLog(in, out));
+    REQUIRE(out.str() == "");
+  }
+
+  std::remove(path.c_str());
+}
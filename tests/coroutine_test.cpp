@@ -0,0 +1,137 @@
+#include "AsyncLib/coroutine.hpp"
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "AsyncLib/worker.hpp"
+#include "catch2/catch_test_macros.hpp"
+
+namespace {
+
+async_lib::Task<int> Add(int a, int b) { co_return a + b; }
+
+async_lib::Task<int> AddThree(int a, int b, int c) {
+  auto const ab = co_await Add(a, b);
+  co_return co_await Add(ab, c);
+}
+
+async_lib::Task<> Throw() {
+  throw std::runtime_error("failed");
+  co_return;
+}
+
+async_lib::Task<std::thread::id> ThreadAfterScheduling(
+    async_lib::TaskWorker<>& worker) {
+  co_await async_lib::ScheduleOn(worker);
+  co_return std::this_thread::get_id();
+}
+
+async_lib::Task<int> PopSum(async_lib::AsyncQueue<int>& queue, int count) {
+  int sum = 0;
+  for (int i = 0; i < count; ++i) {
+    sum += co_await queue.PopAsync();
+  }
+  co_return sum;
+}
+
+}  // namespace
+
+TEST_CASE("Task tests") {
+  SECTION("Returns Value") { REQUIRE(async_lib::SyncWait(Add(1, 2)) == 3); }
+
+  SECTION("Can Await Other Tasks") {
+    REQUIRE(async_lib::SyncWait(AddThree(1, 2, 3)) == 6);
+  }
+
+  SECTION("Can Return Move Only Types") {
+    auto task = []() -> async_lib::Task<std::unique_ptr<int>> {
+      co_return std::make_unique<int>(4);
+    };
+    REQUIRE(*async_lib::SyncWait(task()) == 4);
+  }
+
+  SECTION("Passes On Exceptions") {
+    bool caught = false;
+    try {
+      async_lib::SyncWait(Throw());
+    } catch (std::runtime_error const&) {
+      caught = true;
+    }
+    REQUIRE(caught);
+  }
+
+  SECTION("Task Is Not Started Until Awaited") {
+    bool started = false;
+    auto task = [&]() -> async_lib::Task<> {
+      started = true;
+      co_return;
+    };
+    auto pending = task();
+    REQUIRE_FALSE(started);
+    async_lib::SyncWait(std::move(pending));
+    REQUIRE(started);
+  }
+}
+
+TEST_CASE("Schedule on worker tests") {
+  async_lib::TaskWorker<> worker;
+  worker.StartThread();
+
+  auto const id = async_lib::SyncWait(ThreadAfterScheduling(worker));
+  REQUIRE(id != std::this_thread::get_id());
+
+  worker.KillThread();
+}
+
+TEST_CASE("Async queue tests") {
+  async_lib::AsyncQueue<int> queue;
+
+  SECTION("Pop Async Returns Immediately If Data Waiting") {
+    queue.Push(1);
+    queue.Push(2);
+    REQUIRE(async_lib::SyncWait(PopSum(queue, 2)) == 3);
+    REQUIRE(queue.Size() == 0);
+  }
+
+  SECTION("Pop Async Suspends Until Data Pushed") {
+    std::thread producer([&]() {
+      for (int i = 1; i <= 100; ++i) {
+        queue.Push(i);
+      }
+    });
+    REQUIRE(async_lib::SyncWait(PopSum(queue, 100)) == 5050);
+    producer.join();
+  }
+
+  SECTION("Data Is Handed To Waiters In Order") {
+    std::vector<int> received;
+    auto waiter = [&]() -> async_lib::Task<> {
+      received.push_back(co_await queue.PopAsync());
+    };
+    // Each waiter is started from its own thread so they suspend in order
+    std::vector<std::thread> threads;
+    std::atomic_int started{0};
+    for (int i = 0; i < 3; ++i) {
+      threads.emplace_back([&]() {
+        ++started;
+        async_lib::SyncWait(waiter());
+      });
+      while (started <= i) {
+        std::this_thread::yield();
+      }
+      // Give the waiter a moment to suspend before starting the next
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    for (int i = 0; i < 3; ++i) {
+      queue.Push(i);
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    REQUIRE(received == std::vector<int>{0, 1, 2});
+    REQUIRE_FALSE(queue.TryPop());
+  }
+}
@@ -0,0 +1,53 @@
+#include "AsyncLib/event.hpp"
+
+#include <thread>
+
+#include "catch2/catch_test_macros.hpp"
+#include "helpers.hpp"
+
+TEST_CASE("Event tests") {
+  async_lib::Event event;
+
+  SECTION("Notify Without Waiters Does Nothing") {
+    event.NotifyAll();
+    REQUIRE(event.Waiters() == 0);
+  }
+
+  SECTION("Wait Times Out If Not Notified") {
+    auto const token = event.PrepareWait();
+    REQUIRE_FALSE(event.Wait(token, std::chrono::milliseconds(1)));
+    event.FinishWait();
+    REQUIRE(event.Waiters() == 0);
+  }
+
+  SECTION("Wait Returns Immediately If Notified After Prepare") {
+    auto const token = event.PrepareWait();
+    event.NotifyOne();
+    REQUIRE(event.Wait(token, std::chrono::seconds(10)));
+    event.FinishWait();
+  }
+
+  SECTION("No Wakeups Lost Between Threads") {
+    constexpr int numLoops = 10000;
+    std::atomic_int produced{0};
+    int consumed = 0;
+    RunInParallel(2, [&](int thread) {
+      if (thread == 0) {
+        for (int i = 0; i < numLoops; ++i) {
+          ++produced;
+          event.NotifyOne();
+        }
+      } else {
+        while (consumed < numLoops) {
+          auto const token = event.PrepareWait();
+          if (produced == consumed) {
+            event.Wait(token);
+          }
+          event.FinishWait();
+          consumed = produced;
+        }
+      }
+    });
+    REQUIRE(consumed == numLoops);
+  }
+}
@@ -0,0 +1,195 @@
+#include "AsyncLib/future.hpp"
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AsyncLib/worker.hpp"
+#include "catch2/catch_test_macros.hpp"
+#include "helpers.hpp"
+
+TEST_CASE("Future tests") {
+  async_lib::Promise<int> promise;
+  auto future = promise.GetFuture();
+
+  SECTION("Get Returns Value Set By Promise") {
+    REQUIRE_FALSE(future.IsReady());
+    promise.SetValue(5);
+    REQUIRE(future.IsReady());
+    REQUIRE(future.Get() == 5);
+    REQUIRE_FALSE(future.Valid());
+  }
+
+  SECTION("Get Waits For Value From Another Thread") {
+    std::thread setter([&]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+      promise.SetValue(3);
+    });
+    REQUIRE(future.Get() == 3);
+    setter.join();
+  }
+
+  SECTION("Wait For Times Out If Not Ready") {
+    REQUIRE_FALSE(future.WaitFor(std::chrono::milliseconds(1)));
+    promise.SetValue(1);
+    REQUIRE(future.WaitFor(std::chrono::milliseconds(1)));
+  }
+
+  SECTION("Get Throws Stored Exception") {
+    promise.SetException(std::make_exception_ptr(std::runtime_error("fail")));
+    bool caught = false;
+    try {
+      future.Get();
+    } catch (std::runtime_error const&) {
+      caught = true;
+    }
+    REQUIRE(caught);
+  }
+
+  SECTION("Destroyed Promise Breaks Future") {
+    { auto moved = std::move(promise); }
+    bool caught = false;
+    try {
+      future.Get();
+    } catch (std::future_error const& error) {
+      caught = error.code() == std::future_errc::broken_promise;
+    }
+    REQUIRE(caught);
+  }
+
+  SECTION("Then Runs Continuation When Value Set") {
+    auto chained = future.Then([](int in) { return in * 2; })
+                       .Then([](int in) { return std::to_string(in); });
+    REQUIRE_FALSE(chained.IsReady());
+    promise.SetValue(21);
+    REQUIRE(chained.Get() == "42");
+  }
+
+  SECTION("Then Runs Straight Away If Already Ready") {
+    promise.SetValue(1);
+    bool ran = false;
+    auto chained = future.Then([&](int) { ran = true; });
+    REQUIRE(ran);
+    chained.Get();
+  }
+
+  SECTION("Then Accepts Captures Larger Than The Continuation Buffer") {
+    std::string const prefix = "value ";
+    std::string const suffix = " done";
+    auto chained = future.Then([prefix, suffix](int in) {
+      return prefix + std::to_string(in) + suffix;
+    });
+    promise.SetValue(3);
+    REQUIRE(chained.Get() == "value 3 done");
+  }
+
+  SECTION("Then Skips Continuation On Exception") {
+    bool ran = false;
+    auto chained = future.Then([&](int) { ran = true; });
+    promise.SetException(std::make_exception_ptr(std::runtime_error("fail")));
+    REQUIRE_FALSE(ran);
+    REQUIRE_THROWS_AS(chained.Get(), std::runtime_error);
+  }
+
+  SECTION("Value And Continuation Race Safely") {
+    for (int i = 0; i < 1000; ++i) {
+      async_lib::Promise<int> racePromise;
+      auto raceFuture = racePromise.GetFuture();
+      std::atomic_int result{0};
+      async_lib::Future<void> chained;
+      RunInParallel(2, [&](int thread) {
+        if (thread == 0) {
+          racePromise.SetValue(i);
+        } else {
+          chained = raceFuture.Then([&](int in) { result = in + 1; });
+        }
+      });
+      chained.Wait();
+      REQUIRE(result == i + 1);
+    }
+  }
+}
+
+TEST_CASE("When all and when any tests") {
+  std::vector<async_lib::Promise<int>> promises(3);
+  std::vector<async_lib::Future<int>> futures;
+  for (auto& promise : promises) {
+    futures.push_back(promise.GetFuture());
+  }
+
+  SECTION("When All Collects Values In Order") {
+    auto all = async_lib::WhenAll(std::move(futures));
+    promises[2].SetValue(2);
+    promises[0].SetValue(0);
+    REQUIRE_FALSE(all.IsReady());
+    promises[1].SetValue(1);
+    REQUIRE(all.Get() == std::vector<int>{0, 1, 2});
+  }
+
+  SECTION("When All Passes On Exception") {
+    auto all = async_lib::WhenAll(std::move(futures));
+    promises[0].SetValue(0);
+    promises[1].SetException(
+        std::make_exception_ptr(std::runtime_error("fail")));
+    promises[2].SetValue(2);
+    REQUIRE_THROWS_AS(all.Get(), std::runtime_error);
+  }
+
+  SECTION("When All Of Nothing Is Ready") {
+    auto all = async_lib::WhenAll(std::vector<async_lib::Future<void>>{});
+    REQUIRE(all.IsReady());
+  }
+
+  SECTION("When Any Returns First Value") {
+    auto any = async_lib::WhenAny(std::move(futures));
+    promises[1].SetValue(10);
+    promises[0].SetValue(20);
+    auto const [index, value] = any.Get();
+    REQUIRE(index == 1);
+    REQUIRE(value == 10);
+  }
+}
+
+TEST_CASE("Task worker future tests") {
+  async_lib::TaskWorker<> worker;
+  worker.StartThread();
+
+  SECTION("Add Job Returns Future For Result") {
+    auto future = worker.AddJob([]() { return 7; });
+    REQUIRE(future.Get() == 7);
+  }
+
+  SECTION("Add Job Accepts Captures Larger Than The Task Buffer") {
+    std::string const name = "mesh";
+    int const count = 3;
+    auto future = worker.AddJob([name, count]() {
+      return name + std::to_string(count);
+    });
+    REQUIRE(future.Get() == "mesh3");
+  }
+
+  SECTION("Futures Can Be Combined") {
+    std::vector<async_lib::Future<int>> futures;
+    for (int i = 0; i < 10; ++i) {
+      futures.push_back(worker.AddJob([i]() { return i; }));
+    }
+    auto sum = async_lib::WhenAll(std::move(futures))
+                   .Then([](std::vector<int> values) {
+                     int total = 0;
+                     for (auto value : values) {
+                       total += value;
+                     }
+                     return total;
+                   });
+    REQUIRE(sum.Get() == 45);
+  }
+
+  SECTION("Discarded Job Breaks Future") {
+    worker.KillThread();
+    auto future = worker.AddJob([]() { return 1; });
+    worker.Stop(async_lib::StopMode::IMMEDIATE);
+    REQUIRE_THROWS_AS(future.Get(), std::future_error);
+  }
+}
@@ -0,0 +1,89 @@
+#include "AsyncLib/inplace_function.hpp"
+
+#include <array>
+#include <memory>
+#include <string>
+
+#include "catch2/catch_test_macros.hpp"
+
+TEST_CASE("Inplace function tests") {
+  SECTION("Default Constructed Is Empty") {
+    async_lib::InplaceFunction<void()> function;
+    REQUIRE_FALSE(function);
+  }
+
+  SECTION("Calls Stored Lambda With Arguments") {
+    int offset = 3;
+    async_lib::InplaceFunction<int(int)> function = [offset](int in) {
+      return in + offset;
+    };
+    REQUIRE(function);
+    REQUIRE(function(2) == 5);
+  }
+
+  SECTION("Calls Stored Function Pointer") {
+    async_lib::InplaceFunction<std::size_t(std::string const&)> function =
+        +[](std::string const& in) { return in.size(); };
+    REQUIRE(function("hello") == 5);
+  }
+
+  SECTION("Stores Move Only Captures") {
+    auto value = std::make_unique<int>(7);
+    async_lib::InplaceFunction<int()> function =
+        [value = std::move(value)]() { return *value; };
+    REQUIRE(function() == 7);
+  }
+
+  SECTION("Move Transfers Callable And Empties Source") {
+    async_lib::InplaceFunction<int()> function = []() { return 1; };
+    auto moved = std::move(function);
+    REQUIRE_FALSE(function);
+    REQUIRE(moved() == 1);
+
+    async_lib::InplaceFunction<int()> assigned = []() { return 2; };
+    assigned = std::move(moved);
+    REQUIRE_FALSE(moved);
+    REQUIRE(assigned() == 1);
+  }
+
+  SECTION("Destroys Captures Exactly Once") {
+    auto counter = std::make_shared<int>(0);
+    {
+      async_lib::InplaceFunction<void()> function = [counter]() {};
+      REQUIRE(counter.use_count() == 2);
+      auto moved = std::move(function);
+      REQUIRE(counter.use_count() == 2);
+      moved = nullptr;
+      REQUIRE(counter.use_count() == 1);
+      moved = [counter]() {};
+    }
+    REQUIRE(counter.use_count() == 1);
+  }
+
+  SECTION("Captures Too Large For The Buffer Are Moved To The Heap") {
+    auto counter = std::make_shared<int>(0);
+    std::array<char, 100> data{};
+    data[99] = 'x';
+    {
+      async_lib::InplaceFunction<char()> function = [data, counter]() {
+        return data[99];
+      };
+      REQUIRE(sizeof(function) < sizeof(data));
+      auto moved = std::move(function);
+      REQUIRE_FALSE(function);
+      REQUIRE(moved() == 'x');
+      REQUIRE(counter.use_count() == 2);
+    }
+    REQUIRE(counter.use_count() == 1);
+  }
+
+  SECTION("Larger Captures Fit With Larger Capacity") {
+    std::array<char, 100> data{};
+    data[99] = 'x';
+    async_lib::InplaceFunction<char(), 128> function = [data]() {
+      return data[99];
+    };
+    REQUIRE(function() == 'x');
+    REQUIRE(sizeof(function) > 100);
+  }
+}
@@ -1,6 +1,19 @@
 
 #include "AsyncLib/logger.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
 #include "catch2/catch_test_macros.hpp"
 #include "catch2/matchers/catch_matchers_string.hpp"
 #include "helpers.hpp"
@@ -67,6 +80,16 @@ TEST_CASE("Logger tests") {
     REQUIRE(ss->str() != "");
   }
 
+  SECTION("Runtime Format Strings Can Be Destroyed Straight After") {
+    mainLogger->SetLogFormat("{message}");
+    {
+      std::string format = "{} = {}";
+      mainLogger->Warn(fmt::runtime(format), "Something", 15.6);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    REQUIRE(ss->str() == "Something = 15.6\n");
+  }
+
   SECTION("Can Set Output Format Of Logs") {
     mainLogger->SetLogFormat("{message}");
     mainLogger->Warn("{} = {}", "Something", 15.6);
@@ -87,6 +110,43 @@ TEST_CASE("Logger tests") {
     REQUIRE(time2 > time1);
   }
 
+  SECTION("Timestamps Have Nanosecond Precision") {
+    mainLogger->SetLogFormat("{time:.9f} {date}");
+    mainLogger->Info("Test");
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    auto const line = ss->str();
+    auto const space = line.find(' ');
+    REQUIRE(space - line.find('.') == 10);
+
+    // e.g. 2024-02-29T13:04:05.000000007Z
+    auto const date = line.substr(space + 1);
+    REQUIRE(date.size() == 31);
+    REQUIRE(date[10] == 'T');
+    REQUIRE(date[19] == '.');
+    REQUIRE(date[29] == 'Z');
+  }
+
+  SECTION("Numbers Logs And Threads") {
+    mainLogger->SetLogFormat("{thread} {seq}");
+    mainLogger->Info("Test");
+    std::uint32_t otherThread = 0;
+    std::thread([&]() {
+      mainLogger->Info("Test");
+      otherThread = async_lib::internal::LogThreadId();
+    }).join();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    auto const thisThread = async_lib::internal::LogThreadId();
+
+    std::istringstream lines(ss->str());
+    std::uint32_t thread1, thread2;
+    std::uint64_t seq1, seq2;
+    lines >> thread1 >> seq1 >> thread2 >> seq2;
+    REQUIRE(thread1 == thisThread);
+    REQUIRE(thread2 == otherThread);
+    REQUIRE(thread1 != thread2);
+    REQUIRE(seq2 == seq1 + 1);
+  }
+
   SECTION("Get Logger Creates Default Logger if Not Exist") {
     async_lib::GetLogger();
     REQUIRE(async_lib::internal::loggerRegistry.LoggerExists("Global"));
@@ -98,6 +158,17 @@ TEST_CASE("Logger tests") {
     REQUIRE(logger1 == logger2);
   }
 
+  SECTION("Find Logger Returns Existing Logger") {
+    REQUIRE(registry.FindLogger("MainTest") == mainLogger.get());
+    REQUIRE(registry.FindLogger("DoesNotExist") == nullptr);
+  }
+
+  SECTION("Get Logger Ref Returns Same Logger As Get Logger") {
+    auto& logger = async_lib::GetLoggerRef("RefTest");
+    REQUIRE(&logger == async_lib::GetLogger("RefTest").get());
+    REQUIRE(&async_lib::GetLoggerRef("RefTest") == &logger);
+  }
+
   SECTION("Get Logger Creates New Sink If Does Not Exist") {
     async_lib::GetLogger("SinkTest", "LogFile.log");
     REQUIRE(async_lib::internal::loggerRegistry.SinkExists("LogFile.log"));
@@ -121,6 +192,35 @@ TEST_CASE("Logger tests") {
       }
     }
 
+    SECTION("Get Logger Returns Same Logger From All Threads") {
+      constexpr int numThreads = 50;
+      std::vector<async_lib::Logger*> loggers(numThreads);
+      RunInParallel(numThreads, [&](int thread) {
+        loggers[thread] = async_lib::GetLogger("ParallelGet").get();
+      });
+      for (auto logger : loggers) {
+        REQUIRE(logger == loggers[0]);
+      }
+    }
+
+    SECTION("Can Find Loggers While Others Are Created") {
+      constexpr int numThreads = 10;
+      constexpr int numLoops = 100;
+      registry.CreateLogger("Existing");
+      auto const existing = registry.FindLogger("Existing");
+      std::atomic_int missing{0};
+      RunInParallel(numThreads, [&](int thread) {
+        for (int j = 0; j < numLoops; ++j) {
+          if (thread % 2 == 0) {
+            registry.CreateLogger(fmt::format("{}_{}", thread, j));
+          } else if (registry.FindLogger("Existing") != existing) {
+            ++missing;
+          }
+        }
+      });
+      REQUIRE(missing == 0);
+    }
+
     SECTION("Can Create Sinks In Paralell") {
       constexpr int numThreads = 100;
       constexpr int numLoops = 10;
@@ -138,4 +238,578 @@ TEST_CASE("Logger tests") {
       }
     }
   }
-}
\ No newline at end of file
+}
+namespace {
+
+struct NotDeferrable {
+  int value;
+};
+
+template <class... Args>
+std::string EncodeAndFormat(std::string_view format, Args const&... args) {
+  async_lib::internal::LogArgs logArgs;
+  logArgs.Encode(format, args...);
+  // Moving checks the arguments survive being queued
+  auto moved = std::move(logArgs);
+  fmt::memory_buffer out;
+  moved.Format(out);
+  return fmt::to_string(out);
+}
+
+}  // namespace
+
+template <>
+struct fmt::formatter<NotDeferrable> : fmt::formatter<int> {
+  auto format(NotDeferrable const& in, fmt::format_context& context) const {
+    return fmt::formatter<int>::format(in.value, context);
+  }
+};
+
+TEST_CASE("Deferred log format tests") {
+  SECTION("Formats Arithmetic Arguments") {
+    REQUIRE(EncodeAndFormat("{} {} {} {:.1f} {} {}", 1, -2L, 3u, 15.6f, 2.5,
+                            true) == "1 -2 3 15.6 2.5 true");
+  }
+
+  SECTION("Copies Strings So They Can Be Destroyed") {
+    async_lib::internal::LogArgs logArgs;
+    {
+      std::string temporary = "temporary";
+      char const* literal = "literal";
+      logArgs.Encode("{} {} {}", temporary, literal, std::string_view("view"));
+    }
+    fmt::memory_buffer out;
+    logArgs.Format(out);
+    REQUIRE(fmt::to_string(out) == "temporary literal view");
+  }
+
+  SECTION("Keeps Format Specs") {
+    REQUIRE(EncodeAndFormat("{:>4}|{:x}|{:c}", "a", 255, 'z') == "   a|ff|z");
+  }
+
+  SECTION("Stores Large Arguments Outside The Log") {
+    std::string large(async_lib::internal::LogArgs::INLINE_SIZE * 2, 'x');
+    REQUIRE(EncodeAndFormat("{}{}", large, 1) == large + "1");
+  }
+
+  SECTION("Does Not Copy The Format String") {
+    async_lib::internal::LogArgs logArgs;
+    constexpr char const* format =
+        "A format string that is far longer than the space a log has for its "
+        "arguments, which still only needs room for the one argument {}";
+    logArgs.Encode(format, 1);
+    REQUIRE(logArgs.FormatString().data() == format);
+    REQUIRE(logArgs.Size() < async_lib::internal::LogArgs::INLINE_SIZE);
+    fmt::memory_buffer out;
+    logArgs.Format(out);
+    REQUIRE(fmt::to_string(out).ends_with("argument 1"));
+  }
+
+  SECTION("Copies Runtime Format Strings") {
+    async_lib::internal::LogArgs logArgs;
+    {
+      std::string format(async_lib::internal::LogArgs::INLINE_SIZE, '-');
+      format += "{} {}";
+      logArgs.EncodeCopyingFormat(format, 1, "two");
+    }
+    auto moved = std::move(logArgs);
+    fmt::memory_buffer out;
+    moved.Format(out);
+    REQUIRE(fmt::to_string(out) ==
+            std::string(async_lib::internal::LogArgs::INLINE_SIZE, '-') +
+                "1 two");
+  }
+
+  SECTION("Formats Other Types Straight Away") {
+    REQUIRE(EncodeAndFormat("{:03}", NotDeferrable{7}) == "007");
+  }
+}
+
+TEST_CASE("Intern table tests") {
+  async_lib::internal::InternTable<std::string> table;
+  auto const create = [](std::string const& key) { return key + "!"; };
+
+  SECTION("Same Key Returns Same Handle") {
+    auto const first = table.Intern("first", create);
+    auto const second = table.Intern("second", create);
+    REQUIRE(first != second);
+    REQUIRE(table.Intern("first", create) == first);
+    REQUIRE(table.Get(first) == "first!");
+    REQUIRE(table.Get(second) == "second!");
+  }
+
+  SECTION("Handles Stay Valid As Table Grows") {
+    std::vector<std::uint32_t> handles;
+    for (int i = 0; i < 1000; ++i) {
+      handles.push_back(table.Intern(std::to_string(i), create));
+    }
+    for (int i = 0; i < 1000; ++i) {
+      REQUIRE(table.Get(handles[i]) == std::to_string(i) + "!");
+    }
+  }
+
+  SECTION("Can Intern In Parallel") {
+    std::vector<std::uint32_t> handles(100);
+    RunInParallel(100, [&](int thread) {
+      handles[thread] = table.Intern(std::to_string(thread % 10), create);
+    });
+    for (int i = 0; i < 100; ++i) {
+      REQUIRE(handles[i] == handles[i % 10]);
+      REQUIRE(table.Get(handles[i]) == std::to_string(i % 10) + "!");
+    }
+  }
+}
+
+TEST_CASE("Log clock tests") {
+  using async_lib::internal::LogClock;
+
+  SECTION("Uptime Follows The Monotonic Clock") {
+    auto const steadyStart = std::chrono::steady_clock::now();
+    auto const start = LogClock::Now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    auto const end = LogClock::Now();
+    auto const steady = std::chrono::steady_clock::now() - steadyStart;
+    auto const elapsed = LogClock::Uptime(end) - LogClock::Uptime(start);
+    REQUIRE(elapsed >= std::chrono::milliseconds(19));
+    REQUIRE(elapsed <= steady + std::chrono::milliseconds(1));
+  }
+
+  SECTION("Dates Are Close To The System Clock") {
+    auto const date = LogClock::Time(LogClock::Now()).date;
+    auto const now = std::chrono::system_clock::now();
+    REQUIRE(date <= now + std::chrono::milliseconds(100));
+    REQUIRE(date >= now - std::chrono::milliseconds(100));
+  }
+}
+
+TEST_CASE("Log layout tests") {
+  async_lib::internal::Log log{
+      {},
+      0,
+      42,
+      async_lib::internal::componentNames.Intern(
+          "Layout", [](std::string const& name) { return name; }),
+      0,
+      3,
+      async_lib::internal::LogLevel::WARN};
+  // 2024-02-29T13:04:05.000000007Z
+  async_lib::internal::LogTime const time{
+      std::chrono::milliseconds(1500),
+      async_lib::internal::LogDate(std::chrono::seconds(1709211845) +
+                                   std::chrono::nanoseconds(7))};
+  auto format = [&](std::string_view pattern) {
+    fmt::memory_buffer out;
+    async_lib::internal::LogLayout(pattern).Format(out, log, time, "message");
+    return fmt::to_string(out);
+  };
+
+  SECTION("Outputs Each Field") {
+    REQUIRE(format("[{time}] [{component}] [{level}] {message}") ==
+            "[1.5] [Layout] [Warning] message");
+  }
+
+  SECTION("Applies Field Format Specs") {
+    REQUIRE(format("{time:08.3f}|{component:>8}") == "0001.500|  Layout");
+  }
+
+  SECTION("Outputs Date Thread And Sequence") {
+    REQUIRE(format("{date} {thread} {seq:04}") ==
+            "2024-02-29T13:04:05.000000007Z 3 0042");
+  }
+
+  SECTION("Formats Dates With Strftime Specs") {
+    REQUIRE(format("{date:%d/%m/%Y %H:%M:%S %a}") == "29/02/2024 13:04:05 Thu");
+  }
+
+  SECTION("Keeps Escaped Braces And Unknown Fields") {
+    REQUIRE(format("{{{message}}} {unknown}") == "{message} {unknown}");
+  }
+
+  SECTION("Ignores Invalid Specs") {
+    REQUIRE(format("{component:d}") == "Layout");
+  }
+}
+
+TEST_CASE("Multiple sink tests") {
+  // Records what it is given and which thread gave it
+  class RecordingSink : public async_lib::Sink {
+   public:
+    void Write(async_lib::internal::Log const&,
+               std::string_view const line) override {
+      std::unique_lock lock(mutex_);
+      lines_.emplace_back(line);
+      threads_.push_back(std::this_thread::get_id());
+    }
+
+    std::vector<std::string> Lines() {
+      std::unique_lock lock(mutex_);
+      return lines_;
+    }
+
+    std::vector<std::thread::id> Threads() {
+      std::unique_lock lock(mutex_);
+      return threads_;
+    }
+
+   private:
+    std::mutex mutex_;
+    std::vector<std::string> lines_;
+    std::vector<std::thread::id> threads_;
+  };
+
+  async_lib::internal::LoggerRegistry registry;
+  auto first = std::make_shared<RecordingSink>();
+  auto second = std::make_shared<RecordingSink>();
+  registry.CreateSink("first", first);
+  registry.CreateSink("second", second);
+
+  SECTION("Logger Can Write To Several Sinks") {
+    registry.CreateLogger("Both", "first");
+    REQUIRE(registry.AddSink("Both", "second"));
+    auto logger = registry.GetLogger("Both");
+    logger->SetLogFormat("{message}");
+    logger->Info("Hello {}", 1);
+    registry.FlushAll();
+    REQUIRE(first->Lines() == std::vector<std::string>{"Hello 1"});
+    REQUIRE(second->Lines() == std::vector<std::string>{"Hello 1"});
+  }
+
+  SECTION("Each Sink Has Its Own Level") {
+    registry.CreateLogger("Filtered", "first");
+    registry.AddSink("Filtered", "second", async_lib::internal::LogLevel::WARN);
+    auto logger = registry.GetLogger("Filtered");
+    logger->SetLogFormat("{message}");
+    logger->Info("info");
+    logger->Warn("warn");
+    logger->Error("error");
+    registry.FlushAll();
+    REQUIRE(first->Lines() ==
+            std::vector<std::string>{"info", "warn", "error"});
+    REQUIRE(second->Lines() == std::vector<std::string>{"warn", "error"});
+  }
+
+  SECTION("Adding A Sink Again Changes Its Level") {
+    registry.CreateLogger("Changed", "first");
+    registry.AddSink("Changed", "first", async_lib::internal::LogLevel::ERROR);
+    auto logger = registry.GetLogger("Changed");
+    logger->SetLogFormat("{message}");
+    logger->Warn("warn");
+    logger->Error("error");
+    registry.FlushAll();
+    REQUIRE(first->Lines() == std::vector<std::string>{"error"});
+  }
+
+  SECTION("Cannot Add Sink That Does Not Exist") {
+    registry.CreateLogger("Missing", "first");
+    REQUIRE_FALSE(registry.AddSink("Missing", "DoesNotExist"));
+    REQUIRE_FALSE(registry.AddSink("DoesNotExist", "first"));
+  }
+
+  SECTION("All Sinks Are Written From One Backend Thread") {
+    registry.CreateLogger("One", "first");
+    registry.CreateLogger("Two", "second");
+    registry.GetLogger("One")->Info("one");
+    registry.GetLogger("Two")->Info("two");
+    registry.FlushAll();
+    REQUIRE(first->Threads().size() == 1);
+    REQUIRE(second->Threads().size() == 1);
+    REQUIRE(first->Threads()[0] == second->Threads()[0]);
+    REQUIRE(first->Threads()[0] != std::this_thread::get_id());
+  }
+
+  SECTION("Can Configure Backend Before First Logger") {
+    REQUIRE(registry.ConfigureBackend({.threadName = "log backend"}, 2));
+    registry.CreateLogger("Configured", "first");
+    REQUIRE_FALSE(registry.ConfigureBackend({}, 1));
+  }
+}
+
+TEST_CASE("Log level tests") {
+  async_lib::internal::LoggerRegistry registry;
+  auto ss = std::make_shared<std::ostringstream>();
+  registry.CreateSink("ss", ss);
+  registry.CreateLogger("First", "ss");
+  registry.CreateLogger("Second", "ss");
+  auto first = registry.GetLogger("First");
+  auto second = registry.GetLogger("Second");
+  first->SetLogFormat("{level} {message}");
+  second->SetLogFormat("{level} {message}");
+  auto output = [&]() {
+    registry.FlushAll();
+    auto const result = ss->str();
+    ss->str("");
+    return result;
+  };
+
+  SECTION("Starts At Default Level") {
+    REQUIRE(first->Level() == async_lib::internal::DEFAULT_LOG_LEVEL);
+  }
+
+  SECTION("Drops Logs Above Level") {
+    registry.SetGlobalLevel(async_lib::LogLevel::WARN);
+    first->Error("error");
+    first->Warn("warn");
+    first->Info("info");
+    REQUIRE(output() == "Error error\nWarning warn\n");
+  }
+
+  SECTION("Can Turn On Debug And Trace For One Logger") {
+    registry.SetGlobalLevel(async_lib::LogLevel::INFO);
+    REQUIRE(registry.SetLevel("First", async_lib::LogLevel::TRACE));
+    first->Debug("debug");
+    first->Trace("trace");
+    second->Debug("debug");
+    REQUIRE(output() == "Debug debug\nTrace trace\n");
+  }
+
+  SECTION("Global Level Does Not Override Logger Level") {
+    registry.SetLevel("First", async_lib::LogLevel::INFO);
+    registry.SetGlobalLevel(async_lib::LogLevel::ERROR);
+    REQUIRE(first->Level() == async_lib::LogLevel::INFO);
+    REQUIRE(second->Level() == async_lib::LogLevel::ERROR);
+
+    registry.SetLevel("First", std::nullopt);
+    REQUIRE(first->Level() == async_lib::LogLevel::ERROR);
+  }
+
+  SECTION("New Loggers Use Global Level") {
+    registry.SetGlobalLevel(async_lib::LogLevel::DEBUG);
+    registry.CreateLogger("Third", "ss");
+    REQUIRE(registry.GetLogger("Third")->Level() ==
+            async_lib::LogLevel::DEBUG);
+  }
+
+  SECTION("Cannot Set Level Of Logger That Does Not Exist") {
+    REQUIRE_FALSE(registry.SetLevel("DoesNotExist", async_lib::LogLevel::INFO));
+  }
+
+  SECTION("Macros Only Evaluate Arguments If Logging") {
+    registry.SetGlobalLevel(async_lib::LogLevel::INFO);
+    int evaluated = 0;
+    auto count = [&]() { return ++evaluated; };
+    LOG_DEBUG(first, "{}", count());
+    LOG_INFO(first, "{}", count());
+    LOG_ERROR(first.get(), "{} {}", count(), "done");
+    REQUIRE(evaluated == 2);
+    REQUIRE(output() == "Info 1\nError 2 done\n");
+  }
+
+  SECTION("Macros Accept Logger References") {
+    registry.SetGlobalLevel(async_lib::LogLevel::INFO);
+    auto& logger = *first;
+    LOG_DEBUG(logger, "{}", "hidden");
+    LOG_WARN(logger, "{}", "shown");
+    REQUIRE(output() == "Warning shown\n");
+  }
+}
+
+TEST_CASE("File sink tests") {
+  auto const path = std::string("FileSinkTest.log");
+  auto read = [&]() {
+    std::ifstream file(path);
+    return std::string(std::istreambuf_iterator<char>(file), {});
+  };
+  auto log = [](async_lib::internal::LogLevel const level) {
+    return async_lib::internal::Log{{}, 0, 0, 0, 0, 0, level};
+  };
+  auto const info = log(async_lib::internal::LogLevel::INFO);
+  auto const error = log(async_lib::internal::LogLevel::ERROR);
+
+  SECTION("Buffers Logs Until Flushed") {
+    async_lib::FileSink sink(path, {.interval = std::chrono::hours(1)});
+    REQUIRE(sink.IsOpen());
+    sink.Write(info, "first");
+    sink.Write(info, "second");
+    REQUIRE(read() == "");
+    sink.Flush();
+    REQUIRE(read() == "first\nsecond\n");
+  }
+
+  SECTION("Writes Once Buffer Is Full") {
+    async_lib::FileSink sink(
+        path, {.bufferSize = 12, .interval = std::chrono::hours(1)});
+    sink.Write(info, "first");
+    REQUIRE(read() == "");
+    sink.Write(info, "second");
+    REQUIRE(read() == "first\nsecond\n");
+  }
+
+  SECTION("Writes Straight Away At Flush Level") {
+    async_lib::FileSink sink(path, {.interval = std::chrono::hours(1)});
+    sink.Write(info, "first");
+    sink.Write(error, "second");
+    REQUIRE(read() == "first\nsecond\n");
+  }
+
+  SECTION("Writes Once Interval Has Passed") {
+    async_lib::FileSink sink(path, {.interval = std::chrono::milliseconds(1)});
+    sink.Write(info, "first");
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    sink.Write(info, "second");
+    REQUIRE(read() == "first\nsecond\n");
+  }
+
+  SECTION("Tick Writes Buffer Once Interval Has Passed") {
+    async_lib::FileSink sink(path, {.interval = std::chrono::milliseconds(1)});
+    sink.Write(info, "first");
+    sink.Tick();
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    REQUIRE(read() == "");
+    sink.Tick();
+    REQUIRE(read() == "first\n");
+  }
+
+  SECTION("Writes Remaining Logs When Destroyed") {
+    {
+      async_lib::FileSink sink(path);
+      sink.Write(info, "first");
+    }
+    REQUIRE(read() == "first\n");
+  }
+
+  SECTION("Flush All Writes Logs Sent So Far") {
+    async_lib::internal::LoggerRegistry registry;
+    registry.CreateSink(
+        "file", std::make_shared<async_lib::FileSink>(
+                    path, async_lib::FlushPolicy{
+                              .interval = std::chrono::hours(1)}));
+    registry.CreateLogger("FileTest", "file");
+    auto logger = registry.GetLogger("FileTest");
+    logger->SetLogFormat("{message}");
+    for (int i = 0; i < 100; ++i) {
+      logger->Info("{}", i);
+    }
+    registry.FlushAll();
+    auto const contents = read();
+    REQUIRE(contents.substr(0, 6) == "0\n1\n2\n");
+    REQUIRE(std::count(contents.begin(), contents.end(), '\n') == 100);
+  }
+
+  std::remove(path.c_str());
+}
+
+#ifdef __linux__
+TEST_CASE("Mapped file sink tests") {
+  auto const path = std::string("MappedSinkTest.log");
+  auto read = [](std::string const& file) {
+    std::ifstream stream(file);
+    return std::string(std::istreambuf_iterator<char>(stream), {});
+  };
+  async_lib::internal::Log const log{
+      {}, 0, 0, 0, 0, 0, async_lib::internal::LogLevel::INFO};
+
+  SECTION("Trims File To Logs Written") {
+    {
+      async_lib::MappedFileSink sink(path, {.maxFileSize = 4096});
+      REQUIRE(sink.IsOpen());
+      sink.Write(log, "first");
+      sink.Write(log, "second");
+    }
+    REQUIRE(read(path) == "first\nsecond\n");
+  }
+
+  SECTION("Rotates Once File Is Full") {
+    {
+      async_lib::MappedFileSink sink(path, {.maxFileSize = 16});
+      sink.Write(log, "first");
+      sink.Write(log, "second");
+      sink.Write(log, "third");
+    }
+    REQUIRE(read(path + ".1") == "first\nsecond\n");
+    REQUIRE(read(path) == "third\n");
+  }
+
+  SECTION("Rotates Once File Is Old Enough") {
+    {
+      async_lib::MappedFileSink sink(
+          path, {.maxFileAge = std::chrono::seconds(0)});
+      sink.Write(log, "first");
+      sink.Write(log, "second");
+    }
+    REQUIRE(read(path + ".1") == "first\n");
+    REQUIRE(read(path) == "second\n");
+  }
+
+  SECTION("Only Keeps Max Files") {
+    {
+      async_lib::MappedFileSink sink(path, {.maxFileSize = 2, .maxFiles = 2});
+      for (int i = 0; i < 5; ++i) {
+        sink.Write(log, std::to_string(i));
+      }
+    }
+    REQUIRE(read(path) == "4\n");
+    REQUIRE(read(path + ".1") == "3\n");
+    REQUIRE(read(path + ".2") == "2\n");
+    REQUIRE_FALSE(std::ifstream(path + ".3").is_open());
+  }
+
+  SECTION("Can Be Selected By Get Logger") {
+    async_lib::CreateSink(
+        path, std::make_shared<async_lib::MappedFileSink>(
+                  path, async_lib::RotationPolicy{.maxFileSize = 4096}));
+    auto logger = async_lib::GetLogger("MappedTest", path);
+    logger->SetLogFormat("{message}");
+    logger->Info("Hello {}", 1);
+    async_lib::FlushAll();
+    REQUIRE(read(path).substr(0, 8) == "Hello 1\n");
+  }
+
+  for (auto const& file : {path, path + ".1", path + ".2", path + ".3"}) {
+    std::remove(file.c_str());
+  }
+}
+#endif
+
+TEST_CASE("Insert only map tests") {
+  async_lib::internal::InsertOnlyMap<int> map;
+
+  SECTION("Finds Inserted Values") {
+    REQUIRE(map.Insert("one", 1));
+    REQUIRE(map.Insert("two", 2));
+    REQUIRE(*map.Find("one") == 1);
+    REQUIRE(*map.Find("two") == 2);
+    REQUIRE(map.Find("three") == nullptr);
+    REQUIRE(map.Size() == 2);
+  }
+
+  SECTION("Does Not Overwrite Values") {
+    map.Insert("one", 1);
+    REQUIRE_FALSE(map.Insert("one", 2));
+    REQUIRE(*map.Find("one") == 1);
+  }
+
+  SECTION("Values Stay Valid As Map Grows") {
+    map.Insert("0", 0);
+    auto const first = map.Find("0");
+    for (int i = 1; i < 1000; ++i) {
+      map.Insert(std::to_string(i), i);
+    }
+    REQUIRE(*first == 0);
+    for (int i = 0; i < 1000; ++i) {
+      REQUIRE(*map.Find(std::to_string(i)) == i);
+    }
+    int sum = 0;
+    map.ForEach([&](int const value) { sum += value; });
+    REQUIRE(sum == 999 * 1000 / 2);
+  }
+
+  SECTION("Can Find While Inserting") {
+    map.Insert("first", 1);
+    std::atomic_bool done{false};
+    std::atomic_int missing{0};
+    std::thread reader([&]() {
+      while (!done) {
+        auto const value = map.Find("first");
+        if (!value || *value != 1) {
+          ++missing;
+        }
+      }
+    });
+    for (int i = 0; i < 10000; ++i) {
+      map.Insert(std::to_string(i), i);
+    }
+    done = true;
+    reader.join();
+    REQUIRE(missing == 0);
+  }
+}
@@ -1,5 +1,12 @@
 #include "AsyncLib/queue.hpp"
 
+#include <algorithm>
+#include <memory>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include "catch2/catch_test_macros.hpp"
 #include "helpers.hpp"
 
@@ -80,6 +87,38 @@ TEST_CASE("Queue tests") {
     REQUIRE(queue.Size() == 2);
   }
 
+  SECTION("Size Still Correct After Many Wraps With Non Power Of Two Size") {
+    auto queue = async_lib::Queue<int, 3>();
+    for (int i = 0; i < 10; i++) {
+      queue.Push(i);
+      queue.Push(i);
+      queue.Pop();
+      queue.Pop();
+    }
+    queue.Push(1);
+    queue.Push(2);
+    queue.Push(3);
+    REQUIRE(queue.Size() == 3);
+    REQUIRE(queue.Pop() == 1);
+  }
+
+  SECTION("Can Push And Pop In Bulk") {
+    std::vector<int> in{1, 2, 3};
+    REQUIRE(queue.PushBulk(in) == 3);
+    std::vector<int> out(5);
+    REQUIRE(queue.PopBulk(out) == 3);
+    REQUIRE(out == std::vector<int>{1, 2, 3, 0, 0});
+  }
+
+  SECTION("Consume All Processes Every Element In Order") {
+    queue.Push(1);
+    queue.Push(2);
+    std::vector<int> out;
+    REQUIRE(queue.ConsumeAll([&](int data) { out.push_back(data); }) == 2);
+    REQUIRE(out == std::vector<int>{1, 2});
+    REQUIRE(queue.Size() == 0);
+  }
+
   class TestElement {
    public:
     TestElement() = default;
@@ -99,6 +138,38 @@ TEST_CASE("Queue tests") {
     REQUIRE(queue.Pop() == 1);
   }
 
+  SECTION("Can Process Move Only Types") {
+    auto queue = async_lib::Queue<std::unique_ptr<int>>();
+    queue.Push(std::make_unique<int>(3));
+    REQUIRE(*queue.Pop() == 3);
+  }
+
+  class NoDefaultElement {
+   public:
+    NoDefaultElement(int i, int j) : data(i + j) {}
+    int data;
+  };
+
+  SECTION("Can Emplace Non Default Constructible Classes") {
+    auto queue = async_lib::Queue<NoDefaultElement>();
+    queue.Emplace(1, 2);
+    REQUIRE(queue.Front().data == 3);
+    REQUIRE(queue.Pop().data == 3);
+  }
+
+  SECTION("Elements Destroyed On Pop And Queue Destruction") {
+    auto counter = std::make_shared<int>(0);
+    {
+      auto queue = async_lib::Queue<std::shared_ptr<int>>();
+      queue.Push(counter);
+      queue.Push(counter);
+      REQUIRE(counter.use_count() == 3);
+      queue.Pop();
+      REQUIRE(counter.use_count() == 2);
+    }
+    REQUIRE(counter.use_count() == 1);
+  }
+
   SECTION("Queue concurrent tests") {
     constexpr int numThreads = 10000;
     constexpr int numLoops = 10;
@@ -125,4 +196,357 @@ TEST_CASE("Queue tests") {
       REQUIRE(queue.Size() == 0);
     }
   }
+
+  SECTION("Bulk Consumer Receives Everything In Order From Producer Thread") {
+    constexpr int numItems = 100000;
+    auto queue = async_lib::Queue<int, 16>();
+    bool inOrder = true;
+    RunInParallel(2, [&](int thread) {
+      if (thread == 0) {
+        std::vector<int> in(5);
+        for (int i = 0; i < numItems;) {
+          for (std::size_t j = 0; j < in.size(); ++j) {
+            in[j] = i + static_cast<int>(j);
+          }
+          auto const count = std::min<std::size_t>(in.size(), numItems - i);
+          auto const pushed =
+              queue.PushBulk(std::span<int>(in.data(), count));
+          i += static_cast<int>(pushed);
+          if (pushed == 0) {
+            std::this_thread::yield();
+          }
+        }
+      } else {
+        std::vector<int> out(7);
+        for (int i = 0; i < numItems;) {
+          auto const popped = queue.PopBulk(out);
+          for (std::size_t j = 0; j < popped; ++j) {
+            inOrder = inOrder && out[j] == i++;
+          }
+          if (popped == 0) {
+            std::this_thread::yield();
+          }
+        }
+      }
+    });
+    REQUIRE(inOrder);
+    REQUIRE(queue.Size() == 0);
+  }
+
+  SECTION("Consumer Receives Everything In Order From Producer Thread") {
+    constexpr int numItems = 100000;
+    auto queue = async_lib::Queue<std::string, 16>();
+    bool inOrder = true;
+    RunInParallel(2, [&](int thread) {
+      if (thread == 0) {
+        for (int i = 0; i < numItems;) {
+          if (queue.Size() < queue.Capacity()) {
+            queue.Push(std::to_string(i++));
+          } else {
+            std::this_thread::yield();
+          }
+        }
+      } else {
+        for (int i = 0; i < numItems;) {
+          if (queue.Size() > 0) {
+            inOrder = inOrder && queue.Pop() == std::to_string(i++);
+          } else {
+            std::this_thread::yield();
+          }
+        }
+      }
+    });
+    REQUIRE(inOrder);
+    REQUIRE(queue.Size() == 0);
+  }
+}
+
+TEST_CASE("MPMC Queue tests") {
+  async_lib::Queue<int, 4, async_lib::queue_policy::MPMC> queue;
+
+  SECTION("Can Push And Pop In Order") {
+    queue.Push(5);
+    queue.Push(10);
+    REQUIRE(queue.Size() == 2);
+    REQUIRE(queue.Pop() == 5);
+    REQUIRE(queue.Pop() == 10);
+  }
+
+  SECTION("Try Push Fails When Queue Full") {
+    for (int i = 0; i < 4; ++i) {
+      REQUIRE(queue.TryPush(i));
+    }
+    REQUIRE_FALSE(queue.TryPush(4));
+    REQUIRE(queue.Size() == 4);
+  }
+
+  SECTION("Capacity Is Rounded Up To Power Of Two") {
+    async_lib::Queue<int, 5, async_lib::queue_policy::MPMC> roundedQueue;
+    REQUIRE(roundedQueue.Capacity() == 8);
+  }
+
+  SECTION("Try Pop Fails When Queue Empty") {
+    int data = 0;
+    REQUIRE_FALSE(queue.TryPop(data));
+    queue.Push(3);
+    REQUIRE(queue.TryPop(data));
+    REQUIRE(data == 3);
+  }
+
+  SECTION("Can Process Move Only Types") {
+    async_lib::Queue<std::unique_ptr<int>, 4, async_lib::queue_policy::MPMC>
+        moveQueue;
+    REQUIRE(moveQueue.TryEmplace(std::make_unique<int>(3)));
+    auto data = moveQueue.TryPop();
+    REQUIRE(data);
+    REQUIRE(**data == 3);
+    REQUIRE_FALSE(moveQueue.TryPop());
+  }
+
+  SECTION("Can Push And Pop More Times Than Size Of Queue") {
+    for (int i = 0; i < 10; i++) {
+      REQUIRE(queue.TryPush(i));
+      REQUIRE(queue.Pop() == i);
+    }
+  }
+
+  SECTION("Push Bulk Only Pushes What Fits") {
+    std::vector<int> in{1, 2, 3, 4, 5, 6};
+    REQUIRE(queue.PushBulk(in) == 4);
+    REQUIRE(queue.Size() == 4);
+    REQUIRE(queue.Pop() == 1);
+  }
+
+  SECTION("Pop Bulk Pops Up To Size Of Span") {
+    for (int i = 0; i < 4; ++i) {
+      queue.Push(i);
+    }
+    std::vector<int> out(3);
+    REQUIRE(queue.PopBulk(out) == 3);
+    REQUIRE(out == std::vector<int>{0, 1, 2});
+    REQUIRE(queue.Size() == 1);
+  }
+
+  SECTION("Consume All Processes Every Element Across Wrap Around") {
+    for (int i = 0; i < 3; ++i) {
+      queue.Push(i);
+      queue.Pop();
+    }
+    for (int i = 0; i < 4; ++i) {
+      queue.Push(i);
+    }
+    std::vector<int> out;
+    REQUIRE(queue.ConsumeAll([&](int data) { out.push_back(data); }) == 4);
+    REQUIRE(out == std::vector<int>{0, 1, 2, 3});
+    REQUIRE(queue.TryPush(4));
+  }
+
+  SECTION("Can Safely Push And Pop In Bulk From Many Threads At Once") {
+    constexpr int numThreads = 8;
+    constexpr int numLoops = 2000;
+    async_lib::Queue<int, 64, async_lib::queue_policy::MPMC> sharedQueue;
+    std::atomic_int64_t sum{0};
+    std::atomic_int consumed{0};
+    RunInParallel(numThreads, [&](int thread) {
+      if (thread % 2 == 0) {
+        for (int i = 0; i < numLoops; ++i) {
+          std::vector<int> batch{1, 2, 3};
+          std::span<int> remaining{batch};
+          while (!remaining.empty()) {
+            remaining = remaining.subspan(sharedQueue.PushBulk(remaining));
+            std::this_thread::yield();
+          }
+        }
+      } else {
+        while (consumed < numThreads / 2 * numLoops * 3) {
+          consumed += sharedQueue.ConsumeAll([&](int data) { sum += data; });
+          std::this_thread::yield();
+        }
+      }
+    });
+    REQUIRE(sharedQueue.Size() == 0);
+    REQUIRE(sum == numThreads / 2 * numLoops * 6);
+  }
+
+  SECTION("Can Safely Push And Pop From Many Threads At Once") {
+    constexpr int numThreads = 8;
+    constexpr int numLoops = 10000;
+    async_lib::Queue<int, 64, async_lib::queue_policy::MPMC> sharedQueue;
+    std::atomic_int64_t sum{0};
+    RunInParallel(numThreads, [&](int thread) {
+      if (thread % 2 == 0) {
+        for (int i = 1; i <= numLoops; ++i) {
+          while (!sharedQueue.TryPush(i)) {
+            std::this_thread::yield();
+          }
+        }
+      } else {
+        int data = 0;
+        for (int i = 0; i < numLoops; ++i) {
+          while (!sharedQueue.TryPop(data)) {
+            std::this_thread::yield();
+          }
+          sum += data;
+        }
+      }
+    });
+    REQUIRE(sharedQueue.Size() == 0);
+    REQUIRE(sum == int64_t{numThreads / 2} * numLoops * (numLoops + 1) / 2);
+  }
+}
+
+TEST_CASE("SPSC Queue tests") {
+  async_lib::Queue<int, 4, async_lib::queue_policy::SPSC> queue;
+
+  SECTION("Can Push And Pop In Order") {
+    queue.Push(5);
+    queue.Push(10);
+    REQUIRE(queue.Front() == 5);
+    REQUIRE(queue.Size() == 2);
+    REQUIRE(queue.Pop() == 5);
+    REQUIRE(queue.Pop() == 10);
+  }
+
+  SECTION("Try Push Fails When Queue Full") {
+    for (int i = 0; i < 4; ++i) {
+      REQUIRE(queue.TryPush(i));
+    }
+    REQUIRE_FALSE(queue.TryPush(4));
+    REQUIRE(queue.Size() == 4);
+  }
+
+  SECTION("Elements Destroyed On Queue Destruction") {
+    auto counter = std::make_shared<int>(0);
+    {
+      async_lib::Queue<std::shared_ptr<int>, 4, async_lib::queue_policy::SPSC>
+          sharedQueue;
+      sharedQueue.Push(counter);
+      sharedQueue.Push(counter);
+      sharedQueue.Pop();
+      REQUIRE(counter.use_count() == 2);
+    }
+    REQUIRE(counter.use_count() == 1);
+  }
+
+  SECTION("Size Still Correct When Queue Wraps Around") {
+    for (int i = 0; i < 6; ++i) {
+      queue.Push(i);
+      queue.Pop();
+    }
+    queue.Push(1);
+    queue.Push(2);
+    REQUIRE(queue.Size() == 2);
+  }
+
+  SECTION("Can Push And Pop In Bulk") {
+    std::vector<int> in{1, 2, 3, 4, 5};
+    REQUIRE(queue.PushBulk(in) == 4);
+    std::vector<int> out(2);
+    REQUIRE(queue.PopBulk(out) == 2);
+    REQUIRE(out == std::vector<int>{1, 2});
+    std::vector<int> rest;
+    REQUIRE(queue.ConsumeAll([&](int data) { rest.push_back(data); }) == 2);
+    REQUIRE(rest == std::vector<int>{3, 4});
+  }
+
+  SECTION("Consumer Receives Everything In Order From Producer Thread") {
+    constexpr int numItems = 100000;
+    bool inOrder = true;
+    RunInParallel(2, [&](int thread) {
+      if (thread == 0) {
+        for (int i = 0; i < numItems; ++i) {
+          while (!queue.TryPush(i)) {
+            std::this_thread::yield();
+          }
+        }
+      } else {
+        int data = 0;
+        for (int i = 0; i < numItems; ++i) {
+          while (!queue.TryPop(data)) {
+            std::this_thread::yield();
+          }
+          inOrder = inOrder && data == i;
+        }
+      }
+    });
+    REQUIRE(inOrder);
+    REQUIRE(queue.Size() == 0);
+  }
+}
+
+TEST_CASE("Unbounded Queue tests") {
+  async_lib::Queue<int, 4, async_lib::queue_policy::Unbounded> queue;
+
+  SECTION("Can Push Beyond Segment Size And Pop In Order") {
+    for (int i = 0; i < 10; ++i) {
+      REQUIRE(queue.TryPush(i));
+    }
+    REQUIRE(queue.Size() == 10);
+    for (int i = 0; i < 10; ++i) {
+      REQUIRE(queue.Pop() == i);
+    }
+    REQUIRE_FALSE(queue.TryPop());
+  }
+
+  SECTION("Reserved Segments Are Used For Later Pushes") {
+    queue.Reserve(3);
+    for (int i = 0; i < 16; ++i) {
+      queue.Push(i);
+    }
+    for (int i = 0; i < 16; ++i) {
+      REQUIRE(queue.Pop() == i);
+    }
+    REQUIRE(queue.Size() == 0);
+  }
+
+  SECTION("Can Push And Pop In Bulk Across Segments") {
+    std::vector<int> in{1, 2, 3, 4, 5, 6};
+    REQUIRE(queue.PushBulk(in) == 6);
+    std::vector<int> out(5);
+    REQUIRE(queue.PopBulk(out) == 5);
+    REQUIRE(out == std::vector<int>{1, 2, 3, 4, 5});
+    std::vector<int> rest;
+    REQUIRE(queue.ConsumeAll([&](int data) { rest.push_back(data); }) == 1);
+    REQUIRE(rest == std::vector<int>{6});
+  }
+
+  SECTION("Remaining Elements Destroyed With Queue") {
+    auto counter = std::make_shared<int>(0);
+    {
+      async_lib::Queue<std::shared_ptr<int>, 2,
+                       async_lib::queue_policy::Unbounded>
+          sharedQueue;
+      for (int i = 0; i < 5; ++i) {
+        sharedQueue.Push(counter);
+      }
+      sharedQueue.Pop();
+      sharedQueue.Pop();
+      sharedQueue.Pop();
+      REQUIRE(counter.use_count() == 3);
+    }
+    REQUIRE(counter.use_count() == 1);
+  }
+
+  SECTION("Can Safely Push And Pop From Many Threads At Once") {
+    constexpr int numThreads = 8;
+    constexpr int numLoops = 10000;
+    std::atomic_int64_t sum{0};
+    RunInParallel(numThreads, [&](int thread) {
+      if (thread % 2 == 0) {
+        for (int i = 1; i <= numLoops; ++i) {
+          queue.Push(i);
+        }
+      } else {
+        for (int i = 0; i < numLoops; ++i) {
+          std::optional<int> data;
+          while (!(data = queue.TryPop())) {
+            std::this_thread::yield();
+          }
+          sum += *data;
+        }
+      }
+    });
+    REQUIRE(queue.Size() == 0);
+    REQUIRE(sum == int64_t{numThreads / 2} * numLoops * (numLoops + 1) / 2);
+  }
 }
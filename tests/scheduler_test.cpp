@@ -0,0 +1,125 @@
+#include "AsyncLib/scheduler.hpp"
+
+#include <set>
+
+#include "catch2/catch_test_macros.hpp"
+#include "helpers.hpp"
+
+TEST_CASE("Work stealing deque tests") {
+  async_lib::WorkStealingDeque<int> deque{2};
+
+  SECTION("Pop Returns Newest Item") {
+    deque.Push(1);
+    deque.Push(2);
+    REQUIRE(deque.Pop() == 2);
+    REQUIRE(deque.Pop() == 1);
+    REQUIRE_FALSE(deque.Pop());
+  }
+
+  SECTION("Steal Returns Oldest Item") {
+    deque.Push(1);
+    deque.Push(2);
+    REQUIRE(deque.Steal() == 1);
+    REQUIRE(deque.Size() == 1);
+  }
+
+  SECTION("Grows When Full") {
+    for (int i = 0; i < 100; ++i) {
+      deque.Push(i);
+    }
+    REQUIRE(deque.Size() == 100);
+    REQUIRE(deque.Steal() == 0);
+    REQUIRE(deque.Pop() == 99);
+  }
+
+  SECTION("Every Item Taken Exactly Once With Concurrent Stealers") {
+    constexpr int numItems = 20000;
+    constexpr int numThieves = 3;
+    std::vector<std::vector<int>> taken(numThieves + 1);
+    std::atomic_bool done{false};
+    RunInParallel(numThieves + 1, [&](int thread) {
+      if (thread == 0) {
+        for (int i = 0; i < numItems; ++i) {
+          deque.Push(i);
+          if (i % 3 == 0) {
+            if (auto item = deque.Pop()) {
+              taken[0].push_back(*item);
+            }
+          }
+        }
+        while (auto item = deque.Pop()) {
+          taken[0].push_back(*item);
+        }
+        done = true;
+      } else {
+        while (!done || deque.Size() > 0) {
+          if (auto item = deque.Steal()) {
+            taken[thread].push_back(*item);
+          }
+        }
+      }
+    });
+    std::multiset<int> all;
+    for (auto const& items : taken) {
+      all.insert(items.begin(), items.end());
+    }
+    REQUIRE(all.size() == numItems);
+    REQUIRE(std::set<int>(all.begin(), all.end()).size() == numItems);
+  }
+}
+
+TEST_CASE("Scheduler tests") {
+  async_lib::Scheduler scheduler{4};
+
+  SECTION("Starts Requested Number Of Threads") {
+    REQUIRE(scheduler.ThreadCount() == 4);
+  }
+
+  SECTION("Submit Returns Future With Result") {
+    auto future = scheduler.Submit([]() { return 42; });
+    REQUIRE(future.get() == 42);
+  }
+
+  SECTION("Can Run Many Tasks From Many Threads") {
+    std::atomic_int count{0};
+    std::vector<std::future<void>> futures;
+    std::mutex futuresMutex;
+    RunInParallel(4, [&](int) {
+      for (int i = 0; i < 500; ++i) {
+        auto future = scheduler.Submit([&]() { ++count; });
+        std::unique_lock lock(futuresMutex);
+        futures.push_back(std::move(future));
+      }
+    });
+    for (auto& future : futures) {
+      future.get();
+    }
+    REQUIRE(count == 2000);
+  }
+
+  SECTION("Tasks Can Submit More Tasks") {
+    std::atomic_int count{0};
+    auto future = scheduler.Submit([&]() {
+      std::vector<std::future<void>> children;
+      for (int i = 0; i < 100; ++i) {
+        children.push_back(scheduler.Submit([&]() { ++count; }));
+      }
+      return children;
+    });
+    for (auto& child : future.get()) {
+      child.get();
+    }
+    REQUIRE(count == 100);
+  }
+
+  SECTION("Finishes Outstanding Tasks On Destruction") {
+    std::atomic_int count{0};
+    {
+      async_lib::Scheduler shortLived{2};
+      for (int i = 0; i < 100; ++i) {
+        shortLived.Submit([&]() { ++count; });
+      }
+    }
+    REQUIRE(count == 100);
+  }
+}
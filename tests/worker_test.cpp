@@ -1,7 +1,11 @@
 
 #include "AsyncLib/worker.hpp"
 
+#include <memory>
+#include <vector>
+
 #include "catch2/catch_test_macros.hpp"
+#include "helpers.hpp"
 
 // tests
 // Add capability to run multiple worker threads (will need safe pop when empty)
@@ -31,6 +35,14 @@ TEST_CASE("Worker tests") {
     REQUIRE(out == "Test1Test2");
   }
 
+  SECTION("Can Add More Jobs Than Default Queue Size") {
+    for (std::size_t i = 0; i < async_lib::DEFAULT_QUEUE_SIZE * 5; ++i) {
+      worker.AddJob("a");
+    }
+    worker.Flush();
+    REQUIRE(out.size() == async_lib::DEFAULT_QUEUE_SIZE * 5);
+  }
+
   SECTION("Can Start Worker Thread To Process Jobs") {
     worker.StartThread();
     worker.AddJob("Test3");
@@ -46,4 +58,370 @@ TEST_CASE("Worker tests") {
     // This will terminate if first thread not joined
     worker.StartThread();
   }
-}
\ No newline at end of file
+}
+TEST_CASE("Worker concurrent tests") {
+  std::atomic_int count{0};
+  async_lib::Worker<int> worker{[&](int in) { count += in; }};
+  worker.StartThread();
+
+  SECTION("Can Add Jobs From Many Threads") {
+    constexpr int numThreads = 8;
+    constexpr int numLoops = 100;
+    RunInParallel(numThreads, [&](int) {
+      for (int i = 0; i < numLoops; ++i) {
+        worker.AddJob(1);
+      }
+    });
+    worker.KillThread();
+    worker.Flush();
+    REQUIRE(count == numThreads * numLoops);
+  }
+}
+
+TEST_CASE("Worker can process move only jobs") {
+  int out = 0;
+  async_lib::Worker<std::unique_ptr<int>> worker{
+      [&](std::unique_ptr<int>& in) { out += *in; }};
+  worker.AddJob(std::make_unique<int>(4));
+  worker.Flush();
+  REQUIRE(out == 4);
+}
+
+TEST_CASE("Worker backpressure tests") {
+  typedef async_lib::Queue<const int, 2, async_lib::queue_policy::MPMC>
+      BoundedQueue;
+  std::vector<int> out;
+  auto function = [&](int in) { out.push_back(in); };
+
+  SECTION("Fail Rejects Job When Queue Full") {
+    async_lib::Worker<int, BoundedQueue> worker{
+        function, {.backpressure = async_lib::Backpressure::FAIL}};
+    REQUIRE(worker.AddJob(1));
+    REQUIRE(worker.AddJob(2));
+    REQUIRE_FALSE(worker.AddJob(3));
+    REQUIRE(worker.DroppedJobs() == 1);
+  }
+
+  SECTION("Drop Newest Discards Job Being Added") {
+    async_lib::Worker<int, BoundedQueue> worker{
+        function, {.backpressure = async_lib::Backpressure::DROP_NEWEST}};
+    worker.AddJob(1);
+    worker.AddJob(2);
+    worker.AddJob(3);
+    worker.Flush();
+    REQUIRE(out == std::vector<int>{1, 2});
+    REQUIRE(worker.DroppedJobs() == 1);
+  }
+
+  SECTION("Drop Oldest Makes Space For New Job") {
+    async_lib::Worker<int, BoundedQueue> worker{
+        function, {.backpressure = async_lib::Backpressure::DROP_OLDEST}};
+    worker.AddJob(1);
+    worker.AddJob(2);
+    REQUIRE(worker.AddJob(3));
+    worker.Flush();
+    REQUIRE(out == std::vector<int>{2, 3});
+    REQUIRE(worker.DroppedJobs() == 1);
+  }
+
+  SECTION("Blocking Waits For Space Without Dropping Jobs") {
+    for (auto backpressure : {async_lib::Backpressure::BLOCK,
+                              async_lib::Backpressure::SPIN_THEN_BLOCK}) {
+      std::atomic_int count{0};
+      std::atomic_int added{0};
+      async_lib::Worker<int, BoundedQueue> worker{
+          [&](int in) { count += in; }, {.backpressure = backpressure}};
+      worker.StartThread();
+      RunInParallel(4, [&](int) {
+        for (int i = 0; i < 100; ++i) {
+          added += worker.AddJob(1);
+        }
+      });
+      worker.KillThread();
+      worker.Flush();
+      REQUIRE(added == 400);
+      REQUIRE(count == 400);
+      REQUIRE(worker.DroppedJobs() == 0);
+    }
+  }
+
+  SECTION("Blocking Without A Thread Processes Jobs To Make Space") {
+    async_lib::Worker<int, BoundedQueue> worker{function};
+    for (int i = 0; i < 5; ++i) {
+      REQUIRE(worker.AddJob(i));
+    }
+    worker.Flush();
+    REQUIRE(out == std::vector<int>{0, 1, 2, 3, 4});
+  }
+}
+
+TEST_CASE("Worker thread scaling tests") {
+  std::atomic_int count{0};
+  auto slowFunction = [&](int in) {
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+    count += in;
+  };
+  auto waitForJobs = [&](int expected) {
+    for (int i = 0; i < 1000 && count < expected; ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+  };
+
+  SECTION("Starts Minimum Number Of Threads") {
+    async_lib::Worker<int> worker{slowFunction,
+                                  {.minThreads = 4, .maxThreads = 4}};
+    worker.StartThread();
+    REQUIRE(worker.ThreadCount() == 4);
+    for (int i = 0; i < 100; ++i) {
+      worker.AddJob(1);
+    }
+    waitForJobs(100);
+    REQUIRE(count == 100);
+    worker.KillThread();
+    REQUIRE(worker.ThreadCount() == 0);
+  }
+
+  SECTION("Scales Up When Queue Depth Exceeds Threshold") {
+    async_lib::Worker<int> worker{
+        slowFunction,
+        {.minThreads = 1, .maxThreads = 4, .scaleUpQueueDepth = 2}};
+    worker.StartThread();
+    for (int i = 0; i < 200; ++i) {
+      worker.AddJob(1);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    REQUIRE(worker.ThreadCount() > 1);
+    waitForJobs(200);
+    REQUIRE(count == 200);
+  }
+
+  SECTION("Retires Idle Threads Down To Minimum") {
+    async_lib::Worker<int> worker{slowFunction,
+                                  {.minThreads = 1,
+                                   .maxThreads = 4,
+                                   .scaleUpQueueDepth = 2,
+                                   .idleTimeout = std::chrono::milliseconds(5)}};
+    worker.StartThread();
+    for (int i = 0; i < 200; ++i) {
+      worker.AddJob(1);
+    }
+    waitForJobs(200);
+    for (int i = 0; i < 100 && worker.ThreadCount() > 1; ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    REQUIRE(worker.ThreadCount() == 1);
+  }
+
+  SECTION("Keeps One Thread When Minimum Is Zero") {
+    async_lib::Worker<int> worker{
+        slowFunction,
+        {.minThreads = 0,
+         .maxThreads = 2,
+         .idleTimeout = std::chrono::milliseconds(1)}};
+    worker.StartThread();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    REQUIRE(worker.ThreadCount() == 1);
+    worker.AddJob(1);
+    REQUIRE(worker.Drain(std::chrono::seconds(5)));
+    REQUIRE(count == 1);
+  }
+}
+
+TEST_CASE("Worker wait strategy tests") {
+  std::atomic_int count{0};
+  auto function = [&](int in) { count += in; };
+
+  for (auto strategy :
+       {async_lib::WaitStrategy::BUSY_SPIN, async_lib::WaitStrategy::YIELD,
+        async_lib::WaitStrategy::PARK}) {
+    async_lib::Worker<int> worker{function, {.waitStrategy = strategy}};
+    worker.StartThread();
+    for (int i = 0; i < 100; ++i) {
+      worker.AddJob(1);
+      if (i % 10 == 0) {
+        // Give the thread a chance to go back to waiting
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+      }
+    }
+    for (int i = 0; i < 1000 && count < 100; ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    REQUIRE(count == 100);
+    worker.KillThread();
+    count = 0;
+  }
+}
+
+TEST_CASE("Worker tick tests") {
+  std::atomic_int ticks{0};
+  auto function = [](int) {
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+  };
+
+  SECTION("Ticks While Busy With A Long Batch Of Jobs") {
+    async_lib::Worker<int> worker{
+        function, {.onTick = [&]() { ++ticks; },
+                   .tickInterval = std::chrono::milliseconds(1)}};
+    // Queued up front so the thread never runs out of jobs
+    for (int i = 0; i < 500; ++i) {
+      worker.AddJob(i);
+    }
+    worker.StartThread();
+    worker.Flush();
+    worker.KillThread();
+    REQUIRE(ticks > 0);
+  }
+
+  SECTION("Does Not Tick Before Interval Has Passed") {
+    async_lib::Worker<int> worker{
+        function, {.onTick = [&]() { ++ticks; },
+                   .tickInterval = std::chrono::hours(1)}};
+    for (int i = 0; i < 500; ++i) {
+      worker.AddJob(i);
+    }
+    worker.StartThread();
+    worker.Flush();
+    worker.KillThread();
+    REQUIRE(ticks == 0);
+  }
+}
+
+TEST_CASE("Worker shutdown tests") {
+  std::atomic_int count{0};
+  std::atomic_bool release{false};
+  std::thread::id processedOn;
+  auto function = [&](int in) {
+    while (!release) {
+      std::this_thread::yield();
+    }
+    processedOn = std::this_thread::get_id();
+    count += in;
+  };
+  async_lib::Worker<int> worker{function};
+
+  SECTION("Flush Waits For Worker Thread To Process Jobs") {
+    worker.StartThread();
+    release = true;
+    for (int i = 0; i < 100; ++i) {
+      worker.AddJob(1);
+    }
+    worker.Flush();
+    REQUIRE(count == 100);
+    REQUIRE(processedOn != std::this_thread::get_id());
+  }
+
+  SECTION("Drain Without Thread Processes On Caller") {
+    release = true;
+    worker.AddJob(1);
+    REQUIRE(worker.Drain(std::chrono::seconds(10)));
+    REQUIRE(count == 1);
+    REQUIRE(processedOn == std::this_thread::get_id());
+  }
+
+  SECTION("Drain Times Out If Jobs Are Not Finished") {
+    worker.StartThread();
+    worker.AddJob(1);
+    REQUIRE_FALSE(worker.Drain(std::chrono::milliseconds(5)));
+    release = true;
+    REQUIRE(worker.Drain(std::chrono::seconds(10)));
+    REQUIRE(count == 1);
+  }
+
+  SECTION("Stop Drain All Processes Every Job") {
+    worker.StartThread();
+    for (int i = 0; i < 100; ++i) {
+      worker.AddJob(1);
+    }
+    release = true;
+    REQUIRE(worker.Stop(async_lib::StopMode::DRAIN_ALL) == 0);
+    REQUIRE(count == 100);
+    REQUIRE(worker.ThreadCount() == 0);
+  }
+
+  SECTION("Stop Immediate Discards Queued Jobs") {
+    release = true;
+    for (int i = 0; i < 100; ++i) {
+      worker.AddJob(1);
+    }
+    REQUIRE(worker.Stop(async_lib::StopMode::IMMEDIATE) == 100);
+    REQUIRE(count == 0);
+    REQUIRE(worker.Drain(std::chrono::seconds(10)));
+  }
+
+  SECTION("Stop Deadline Discards Jobs Left After Timeout") {
+    worker.StartThread();
+    for (int i = 0; i < 100; ++i) {
+      worker.AddJob(1);
+    }
+    std::thread releaser([&]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      release = true;
+    });
+    auto const discarded = worker.Stop(async_lib::StopMode::DEADLINE,
+                                       std::chrono::milliseconds(1));
+    releaser.join();
+    REQUIRE(discarded > 0);
+    REQUIRE(count + discarded == 100);
+  }
+}
+
+TEST_CASE("Task worker tests") {
+  std::atomic_int count{0};
+  async_lib::TaskWorker worker;
+
+  SECTION("Runs Submitted Tasks On Flush") {
+    for (int i = 0; i < 10; ++i) {
+      worker.Submit([&count, i]() { count += i; });
+    }
+    worker.Flush();
+    REQUIRE(count == 45);
+  }
+
+  SECTION("Runs Move Only Tasks In Thread") {
+    worker.StartThread();
+    auto value = std::make_unique<int>(5);
+    worker.Submit([&count, value = std::move(value)]() { count += *value; });
+    for (int i = 0; i < 1000 && count == 0; ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    REQUIRE(count == 5);
+  }
+}
+
+#ifdef __linux__
+TEST_CASE("Worker thread placement tests") {
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  sched_getaffinity(0, sizeof(allowed), &allowed);
+  int cpu = 0;
+  while (!CPU_ISSET(cpu, &allowed)) {
+    ++cpu;
+  }
+
+  std::atomic_int ranOn{-1};
+  std::string name;
+  std::atomic_bool done{false};
+  auto function = [&](int) {
+    char buffer[16];
+    pthread_getname_np(pthread_self(), buffer, sizeof(buffer));
+    name = buffer;
+    ranOn = sched_getcpu();
+    done = true;
+  };
+  async_lib::Worker<int> worker{function,
+                                {.cpuAffinity = {cpu},
+                                 .threadName = "placement-test-thread",
+                                 .reserveSegments = 2}};
+  worker.StartThread();
+  worker.AddJob(1);
+  for (int i = 0; i < 1000 && !done; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  worker.KillThread();
+
+  REQUIRE(done);
+  REQUIRE(ranOn == cpu);
+  REQUIRE(name == "placement-test-");
+  REQUIRE(worker.PlacementErrors() == 0);
+}
+#endif
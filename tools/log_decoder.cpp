@@ -0,0 +1,36 @@
+#include <fstream>
+#include <iostream>
+
+#include "AsyncLib/binary_log.hpp"
+
+// Turns a log written by a BinarySink back into text, using the layout each
+// log was written with
+//   log_decoder <binary log> [output file]
+int main(int argc, char** argv) {
+  if (argc < 2 || argc > 3) {
+    std::cerr << "Usage: " << argv[0] << " <binary log> [output file]"
+              << std::endl;
+    return 2;
+  }
+
+  std::ifstream in(argv[1], std::ios::binary);
+  if (!in) {
+    std::cerr << "Could not open " << argv[1] << std::endl;
+    return 1;
+  }
+
+  std::ofstream file;
+  if (argc == 3) {
+    file.open(argv[2]);
+    if (!file) {
+      std::cerr << "Could not open " << argv[2] << std::endl;
+      return 1;
+    }
+  }
+
+  if (!async_lib::DecodeBinaryLog(in, argc == 3 ? file : std::cout)) {
+    std::cerr << argv[1] << " is not a binary log or is incomplete"
+              << std::endl;
+    return 1;
+  }
+}